@@ -0,0 +1,106 @@
+#include "AVLTree.h"
+#include "TermDictionary.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Lookup latency and memory of the frozen TermDictionary against the
+// AVLTree it replaced, over random keys with many shared prefixes. A quarter
+// of the lookups miss.
+//
+//   DictionaryBench [keys]
+
+namespace {
+
+// Heap bytes requested so far, to size the tree
+size_t allocatedBytes = 0;
+
+using Clock = std::chrono::steady_clock;
+
+template<typename F>
+void report(const char* name, const std::vector<std::string>& probes, F find) {
+    size_t hits = 0;
+    auto started = Clock::now();
+    for (const auto& probe : probes) {
+        hits += find(probe);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - started).count() / probes.size();
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(8) << ns << " ns/lookup  (hits " << hits << ")\n";
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocatedBytes += size;
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 200000;
+    std::mt19937 rng(5);
+
+    // Mostly the first 8 letters, so neighbouring keys share prefixes
+    std::set<std::string> unique;
+    while (unique.size() < count) {
+        std::string key;
+        for (size_t length = 3 + rng() % 10; length > 0; --length) {
+            key += static_cast<char>('a' + (rng() % 26 < 20 ? rng() % 8 : rng() % 26));
+        }
+        unique.insert(key);
+    }
+    std::vector<std::string> keys(unique.begin(), unique.end());
+    std::vector<std::string> probes;
+    for (size_t i = 0; i < 1000000; ++i) {
+        probes.push_back(keys[rng() % count]);
+        if (i % 4 == 0) {
+            probes.back() += 'q';
+        }
+    }
+
+    // The tree is built in random order, as indexing would
+    std::vector<std::string> shuffled = keys;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    size_t before = allocatedBytes;
+    AVLTree<std::string, uint32_t> tree;
+    for (size_t i = 0; i < shuffled.size(); ++i) {
+        tree.insert(shuffled[i], static_cast<uint32_t>(i));
+    }
+    size_t treeBytes = allocatedBytes - before;
+
+    TermDictionaryBuilder builder;
+    for (const auto& key : keys) {
+        builder.add(key);
+    }
+    TermDictionary dictionary(builder.finish());
+
+    size_t keyBytes = 0;
+    for (const auto& key : keys) {
+        keyBytes += key.size();
+    }
+    std::cout << count << " keys, " << keyBytes << " key bytes\n";
+
+    // Second round with warm caches
+    for (int round = 0; round < 2; ++round) {
+        report("AVLTree", probes, [&](const std::string& key) { return tree.findPtr(key) != nullptr; });
+        report("TermDictionary", probes, [&](const std::string& key) {
+            return dictionary.find(key) != TermDictionary::NOT_FOUND;
+        });
+    }
+    std::cout << "AVLTree heap bytes         " << treeBytes << "\n";
+    std::cout << "TermDictionary bytes       " << dictionary.encodedSize() << "\n";
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "PostingList.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Posting list decode and skip throughput: a full scan with next(), and
+// advance() to targets spaced further and further apart, which skips more
+// and more blocks by their headers alone.
+//
+//   PostingListBench [postings]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+PostingList makeList(size_t postings, uint32_t meanGap, std::mt19937& rng) {
+    std::geometric_distribution<uint32_t> gaps(1.0 / meanGap);
+    std::geometric_distribution<uint32_t> frequencies(0.5);
+    PostingList list;
+    uint32_t docId = 0;
+    for (size_t i = 0; i < postings; ++i) {
+        docId += 1 + gaps(rng);
+        list.append(docId, 1 + frequencies(rng), 100 + rng() % 900);
+    }
+    list.seal();
+    return list;
+}
+
+double secondsSince(Clock::time_point started) {
+    return std::chrono::duration<double>(Clock::now() - started).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t postings = argc > 1 ? std::stoul(argv[1]) : 10000000;
+    std::mt19937 rng(3);
+    PostingList list = makeList(postings, 8, rng);
+    PostingListView view = list.view();
+    std::cout << postings << " postings, " << std::fixed << std::setprecision(2)
+              << 8.0 * view.size / postings << " bits each\n";
+
+    // Best of a few rounds, so one noisy round doesn't decide
+    const int rounds = 3;
+    double best = 0;
+    uint64_t checksum = 0;
+    for (int round = 0; round < rounds; ++round) {
+        auto started = Clock::now();
+        checksum = 0;
+        for (auto it = view.iterator(); it.docId() != PostingIterator::END; it.next()) {
+            checksum += it.docId() + it.frequency();
+        }
+        double seconds = secondsSince(started);
+        best = round == 0 ? seconds : std::min(best, seconds);
+    }
+    std::cout << "decode      " << std::setw(10) << std::setprecision(1) << postings / best / 1e6
+              << " M postings/s  (checksum " << checksum << ")\n";
+
+    // Targets every stride postings apart, on average
+    uint32_t lastDocId = list.lastDocId();
+    for (uint32_t stride : {4u, 32u, 256u, 4096u}) {
+        uint64_t step = 8ull * stride;
+        size_t advances = 0;
+        for (int round = 0; round < rounds; ++round) {
+            auto started = Clock::now();
+            checksum = 0;
+            advances = 0;
+            auto it = view.iterator();
+            for (uint64_t target = step; target <= lastDocId; target += step) {
+                checksum += it.advance(static_cast<uint32_t>(target));
+                advances++;
+            }
+            double seconds = secondsSince(started);
+            best = round == 0 ? seconds : std::min(best, seconds);
+        }
+        std::cout << "advance/" << std::left << std::setw(5) << stride << std::right << std::setw(8)
+                  << std::setprecision(1) << best * 1e9 / advances << " ns/advance    "
+                  << std::setw(8) << postings / best / 1e6 << " M postings/s skipped"
+                  << "  (checksum " << checksum << ")\n";
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "IndexHandler.h"
+#include "QueryProcessor.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Queries per second with 1, 2, 4, ... threads sharing one QueryProcessor
+// over one index, up to twice the hardware threads. Every answer is checked
+// against the single-threaded one. The index is built in memory from
+// synthetic documents whose terms w1, w2, ... follow a Zipf distribution.
+//
+//   QueryBench [documents] [seconds per thread count]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::unique_ptr<Document> makeDocument(size_t number, size_t vocabulary, std::mt19937& rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<std::string> words;
+    size_t bytes = 0;
+    for (size_t length = 100 + rng() % 200; length > 0; --length) {
+        size_t rank = static_cast<size_t>(std::pow(static_cast<double>(vocabulary), uniform(rng)));
+        words.push_back("w" + std::to_string(rank));
+        bytes += words.back().size();
+    }
+
+    // Terms are views into the document's buffer, which must not move
+    std::vector<char> buffer;
+    buffer.reserve(bytes);
+    for (const auto& word : words) {
+        buffer.insert(buffer.end(), word.begin(), word.end());
+    }
+    std::vector<std::string_view> terms;
+    size_t offset = 0;
+    for (const auto& word : words) {
+        terms.emplace_back(buffer.data() + offset, word.size());
+        offset += word.size();
+    }
+
+    auto doc = std::make_unique<Document>("doc" + std::to_string(number) + ".json");
+    doc->setTitle("Document " + std::to_string(number));
+    doc->setTerms(std::move(buffer), std::move(terms));
+    return doc;
+}
+
+std::string fingerprint(const SearchResults& results) {
+    std::string text = std::to_string(results.totalMatches);
+    for (const auto& doc : results.documents) {
+        text += " " + std::to_string(doc->getDocId());
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t documents = argc > 1 ? std::stoul(argv[1]) : 20000;
+    double seconds = argc > 2 ? std::stod(argv[2]) : 3.0;
+
+    IndexHandler index;
+    index.setStorePositions(true);
+    std::mt19937 rng(11);
+    for (size_t i = 0; i < documents; ++i) {
+        index.addDocument(makeDocument(i, 20000, rng));
+    }
+    index.finalizeIndex();
+    index.waitForMerges();
+
+    // AND, OR, exclusion, wildcard, fuzzy, phrase and NEAR queries
+    QueryProcessor processor(&index);
+    const std::vector<std::string> queries = {
+        "w1 w2", "w3 OR w10 OR w50", "w5 -w7", "w1*", "w12~1",
+        "\"w1 w2\"", "w2 NEAR/5 w9", "w100 w200 w300", "w8 OR w4000"};
+    std::vector<std::string> expected;
+    for (const auto& query : queries) {
+        expected.push_back(fingerprint(processor.search(query, 10)));
+    }
+
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << documents << " documents, " << index.segmentCount() << " segments, "
+              << hardwareThreads << " hardware threads\n";
+
+    double singleThreaded = 0;
+    for (unsigned threadCount = 1; threadCount <= 2 * hardwareThreads; threadCount *= 2) {
+        std::atomic<size_t> answered{0};
+        std::atomic<size_t> mismatches{0};
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+        auto started = Clock::now();
+        for (unsigned t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t] {
+                size_t count = 0;
+                for (size_t i = t; !stop; ++i, ++count) {
+                    size_t q = i % queries.size();
+                    if (fingerprint(processor.search(queries[q], 10)) != expected[q]) {
+                        mismatches++;
+                    }
+                }
+                answered += count;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+        double qps = answered / elapsed;
+        if (threadCount == 1) {
+            singleThreaded = qps;
+        }
+        std::cout << std::setw(3) << threadCount << " threads " << std::fixed << std::setprecision(0)
+                  << std::setw(8) << qps << " QPS  " << std::setprecision(2) << qps / singleThreaded
+                  << "x  (" << mismatches << " mismatches)\n";
+    }
+    return 0;
+}
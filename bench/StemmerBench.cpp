@@ -0,0 +1,87 @@
+#include "Stemmer.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Stemming cost per word: the allocating stemWord and the in-place stem,
+// over a Zipf-distributed stream like news text.
+//
+//   StemmerBench [words]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Short random stems with common English suffixes, so every Porter step
+// gets exercised
+std::vector<std::string> makeVocabulary(size_t size, std::mt19937& rng) {
+    static const char letters[] = "aeiouybcdfghlmnrstwyyy";
+    static const char* suffixes[] = {"sses", "ies", "ss", "s", "eed", "ed", "ing", "y", "ational", "tional",
+                                     "enci", "anci", "icate", "ative", "alize", "ment", "ness", "tion", "e", ""};
+    const size_t suffixCount = sizeof(suffixes) / sizeof(suffixes[0]);
+    std::vector<std::string> words;
+    for (size_t i = 0; i < size; ++i) {
+        std::string word;
+        for (size_t j = 1 + rng() % 8; j > 0; --j) {
+            word += letters[rng() % (sizeof(letters) - 1)];
+        }
+        word += suffixes[rng() % suffixCount];
+        if (rng() % 3 == 0) {
+            word += suffixes[rng() % suffixCount];
+        }
+        words.push_back(word);
+    }
+    return words;
+}
+
+template<typename F>
+void report(const char* name, size_t words, F run) {
+    auto started = Clock::now();
+    size_t checksum = run();
+    double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << seconds * 1e9 / words << " ns/word  (checksum " << checksum << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 5000000;
+    std::mt19937 rng(1);
+    std::vector<std::string> vocabulary = makeVocabulary(20000, rng);
+
+    // Rank r is drawn with probability ~ 1/r
+    std::vector<const std::string*> stream;
+    stream.reserve(count);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (size_t i = 0; i < count; ++i) {
+        size_t rank = static_cast<size_t>(std::pow(static_cast<double>(vocabulary.size()), uniform(rng))) - 1;
+        stream.push_back(&vocabulary[rank]);
+    }
+    std::cout << count << " words drawn from " << vocabulary.size() << " distinct\n";
+
+    Stemmer stemmer;
+    char buffer[256];
+    report("stemWord", count, [&] {
+        size_t sum = 0;
+        for (const std::string* word : stream) {
+            sum += stemmer.stemWord(*word).size();
+        }
+        return sum;
+    });
+    report("stem", count, [&] {
+        size_t sum = 0;
+        for (const std::string* word : stream) {
+            std::memcpy(buffer, word->data(), word->size());
+            sum += stemmer.stem(buffer, word->size());
+        }
+        return sum;
+    });
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "Tokenizer.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Tokenizer throughput of each kernel the CPU supports, over news-like
+// English text.
+//
+//   TokenizerBench [megabytes]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* kernelName(Tokenizer::Kernel kernel) {
+    switch (kernel) {
+        case Tokenizer::Kernel::SSE2: return "SSE2";
+        case Tokenizer::Kernel::AVX2: return "AVX2";
+        default: return "SCALAR";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 100;
+    const std::string sentence =
+        "The Federal Reserve's chairman said on Tuesday that rates (may) rise again -- "
+        "markets fell 1.2% in early trading; \"We'll see,\" one analyst told Reuters. ";
+    std::string text;
+    while (text.size() < 2 * 1024 * 1024) {
+        text += sentence;
+    }
+    size_t rounds = std::max<size_t>(1, megabytes * 1024 * 1024 / text.size());
+
+    std::vector<Tokenizer::Kernel> kernels{Tokenizer::Kernel::SCALAR};
+    Tokenizer::Kernel best = Tokenizer::selectKernel();
+    if (best != Tokenizer::Kernel::SCALAR) {
+        kernels.push_back(Tokenizer::Kernel::SSE2);
+    }
+    if (best == Tokenizer::Kernel::AVX2) {
+        kernels.push_back(Tokenizer::Kernel::AVX2);
+    }
+
+    std::vector<char> buffer;
+    std::vector<std::string_view> tokens;
+    for (Tokenizer::Kernel kernel : kernels) {
+        // Tokenizing works in place, so every round starts from a fresh copy;
+        // only the tokenizing is timed
+        double seconds = 0;
+        size_t tokenCount = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            buffer.assign(text.begin(), text.end());
+            auto started = Clock::now();
+            Tokenizer::tokenize(buffer.data(), buffer.size(), tokens, kernel);
+            seconds += std::chrono::duration<double>(Clock::now() - started).count();
+            tokenCount += tokens.size();
+        }
+        std::cout << std::left << std::setw(8) << kernelName(kernel) << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(8) << rounds * text.size() / seconds / 1e6
+                  << " MB/s  (" << tokenCount / rounds << " tokens per round)\n";
+    }
+    return 0;
+}
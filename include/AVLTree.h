@@ -1,64 +1,84 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
 
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <vector>
-#include <sstream>
-#include <memory>
-#include "Document.h"
-
-template<typename Key, typename Value>
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include "NodePool.h"
+
+// Balanced search tree used to build the indices. Nodes come from a node
+// allocator (NodePool by default) instead of one heap allocation each, so
+// building allocates in bulk and clearing the tree releases every node at
+// once. Lookups, inserts and traversal are iterative.
+template<typename Key, typename Value, template<typename> class NodeAllocator = NodePool>
 class AVLTree {
 public:
     AVLTree() : root(nullptr) {}
-    ~AVLTree() { destroy(root); }
+
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
 
     void insert(const Key& key, const Value& value) {
-        root = insertHelper(root, key, value);
+        upsertNode(key)->value = value;
     }
 
     Value find(const Key& key) const {
-        Node* node = findHelper(root, key);
+        Node* node = findNode(key);
         if (node) {
             return node->value;
         }
         return Value();
     }
 
-    bool contains(const Key& key) const {
-        return findHelper(root, key) != nullptr;
-    }
-    
-    void saveToFile(const std::string& filePath) const {
-        std::ofstream outFile(filePath, std::ios::binary);
-        if (outFile.is_open()) {
-            saveToFileHelper(root, outFile);
-            outFile.close();
-        }
+    // Pointer to the stored value, or nullptr if the key is absent (no copy)
+    const Value* findPtr(const Key& key) const {
+        Node* node = findNode(key);
+        return node ? &node->value : nullptr;
     }
 
-    void loadFromFile(const std::string& filePath) {
-        destroy(root);
-        root = nullptr;
+    Value* findPtr(const Key& key) {
+        Node* node = findNode(key);
+        return node ? &node->value : nullptr;
+    }
+
+    // Return the value for key, inserting a default-constructed one if needed,
+    // so callers can update it in place. The lookup key may be any type
+    // comparable with Key (e.g. std::string_view for std::string keys);
+    // a Key is only constructed when a node is inserted.
+    template<typename LookupKey = Key>
+    Value& upsert(const LookupKey& key) {
+        return upsertNode(key)->value;
+    }
 
-        std::ifstream inFile(filePath, std::ios::binary);
-        if (inFile.is_open()) {
-            std::string line;
-            while (std::getline(inFile, line)) {
-                size_t pos = line.find(';');
-                if (pos != std::string::npos) {
-                    Key key = line.substr(0, pos);
-                    Value value;
-                    deserializeValue(value, line.substr(pos + 1));
-                    insert(key, value);
-                }
+    // Visit every key/value pair in key order
+    template<typename Visitor>
+    void forEach(Visitor visit) {
+        Node* stack[MAX_HEIGHT];
+        size_t depth = 0;
+        Node* node = root;
+        while (node || depth > 0) {
+            while (node) {
+                stack[depth++] = node;
+                node = node->left;
             }
-            inFile.close();
+            node = stack[--depth];
+            visit(node->key, node->value);
+            node = node->right;
         }
     }
 
+    bool contains(const Key& key) const {
+        return findNode(key) != nullptr;
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    // Remove every node
+    void clear() {
+        nodes.clear();
+        root = nullptr;
+    }
+
 private:
     struct Node {
         Key key;
@@ -67,64 +87,58 @@ private:
         Node* right;
         int height;
 
-        Node(const Key& k, const Value& v)
-            : key(k), value(v), left(nullptr), right(nullptr), height(1) {}
+        explicit Node(Key k)
+            : key(std::move(k)), value(), left(nullptr), right(nullptr), height(1) {}
     };
 
-    Node* root;
-
-    Node* insertHelper(Node* node, const Key& key, const Value& value) {
-        if (!node) {
-            return new Node(key, value);
-        }
-
-        if (key < node->key) {
-            node->left = insertHelper(node->left, key, value);
-        } else if (key > node->key) {
-            node->right = insertHelper(node->right, key, value);
-        } else {
-            // Key exists, update value
-            node->value = value;
-            return node;
-        }
-
-        updateHeight(node);
-        int balance = getBalance(node);
+    // An AVL tree of height h holds at least Fib(h + 2) - 1 nodes, so 96
+    // levels is more than any tree that fits in memory
+    static constexpr size_t MAX_HEIGHT = 96;
 
-        // Left Left Case
-        if (balance > 1 && key < node->left->key) {
-            return rotateRight(node);
-        }
+    Node* root;
+    NodeAllocator<Node> nodes;
 
-        // Right Right Case
-        if (balance < -1 && key > node->right->key) {
-            return rotateLeft(node);
+    Node* findNode(const Key& key) const {
+        Node* node = root;
+        while (node && !(node->key == key)) {
+            node = key < node->key ? node->left : node->right;
         }
-
-        // Left Right Case
-        if (balance > 1 && key > node->left->key) {
-            node->left = rotateLeft(node->left);
-            return rotateRight(node);
-        }
-
-        // Right Left Case
-        if (balance < -1 && key < node->right->key) {
-            node->right = rotateRight(node->right);
-            return rotateLeft(node);
-        }
-
         return node;
     }
 
-    Node* findHelper(Node* node, const Key& key) const {
-        if (!node || node->key == key) {
-            return node;
+    template<typename LookupKey>
+    Node* upsertNode(const LookupKey& key) {
+        // Descend, remembering the link to every node on the way
+        Node** path[MAX_HEIGHT];
+        size_t depth = 0;
+        Node** link = &root;
+        while (*link) {
+            Node* node = *link;
+            if (key < node->key) {
+                path[depth++] = link;
+                link = &node->left;
+            } else if (key > node->key) {
+                path[depth++] = link;
+                link = &node->right;
+            } else {
+                // Key exists, hand back the existing node
+                return node;
+            }
         }
 
-        if (key < node->key) {
-            return findHelper(node->left, key);
+        Node* target = nodes.create(Key(key));
+        *link = target;
+
+        // Rebalance on the way back up; once a subtree keeps its old
+        // height nothing above it changes
+        while (depth > 0) {
+            Node** parent = path[--depth];
+            int oldHeight = (*parent)->height;
+            updateHeight(*parent);
+            *parent = rebalance(*parent);
+            if ((*parent)->height == oldHeight) break;
         }
-        return findHelper(node->right, key);
+        return target;
     }
 
     int getHeight(Node* node) const {
@@ -135,6 +149,28 @@ private:
         return node ? getHeight(node->left) - getHeight(node->right) : 0;
     }
 
+    Node* rebalance(Node* node) {
+        int balance = getBalance(node);
+
+        // Left Left and Left Right Cases
+        if (balance > 1) {
+            if (getBalance(node->left) < 0) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+
+        // Right Right and Right Left Cases
+        if (balance < -1) {
+            if (getBalance(node->right) > 0) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+
+        return node;
+    }
+
     Node* rotateRight(Node* y) {
         Node* x = y->left;
         Node* T2 = x->right;
@@ -161,71 +197,9 @@ private:
         return y;
     }
 
-    void destroy(Node* node) {
-        if (node) {
-            destroy(node->left);
-            destroy(node->right);
-            delete node;
-        }
-    }
-
-    void saveToFileHelper(Node* node, std::ofstream& outFile) const {
-        if (node) {
-            saveToFileHelper(node->left, outFile);
-            outFile << node->key << ";";
-            
-            // Handle vector<shared_ptr<Document>> specially
-            if constexpr (std::is_same_v<Value, std::vector<std::shared_ptr<Document>>>) {
-                const auto& docs = node->value;
-                outFile << docs.size();
-                for (const auto& doc : docs) {
-                    outFile << " " << doc->getFilePath()
-                           << " " << doc->getTitle()
-                           << " " << doc->getPublication()
-                           << " " << doc->getDatePublished()
-                           << " " << doc->getText();
-                }
-            } else {
-                outFile << node->value;
-            }
-            outFile << "\n";
-            
-            saveToFileHelper(node->right, outFile);
-        }
-    }
-    
     void updateHeight(Node* node) {
         node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
     }
-
-    template<typename T>
-    void serializeValue(const std::vector<T>& vec, std::ofstream& outFile) const;
-
-    template<typename T>
-    void deserializeValue(std::vector<T>& vec, const std::string& str);
-
-    // Add this specialization for Document pointers
-    template<>
-    void deserializeValue(std::vector<std::shared_ptr<Document>>& docs, const std::string& str) {
-        std::istringstream iss(str);
-        size_t size;
-        iss >> size;
-        docs.clear();
-        
-        for (size_t i = 0; i < size; ++i) {
-            std::string filePath, title, publication, datePublished, text;
-            iss >> filePath >> title >> publication >> datePublished;
-            std::getline(iss, text);  // Get the rest of the line as text
-            
-            auto doc = std::make_shared<Document>(filePath);
-            doc->setTitle(title);
-            doc->setPublication(publication);
-            doc->setDatePublished(datePublished);
-            doc->setText(text);
-            
-            docs.push_back(doc);
-        }
-    }
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,73 @@
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Little helpers for the binary index formats. Fixed-width integers are
+// stored in host (little-endian) byte order and read with memcpy, so they
+// don't need to be aligned inside a mapped file.
+namespace BinaryIO {
+
+inline void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline const uint8_t* readVarint(const uint8_t* in, uint32_t& value) {
+    uint32_t result = 0;
+    int shift = 0;
+    while (*in & 0x80) {
+        result |= static_cast<uint32_t>(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value = result | (static_cast<uint32_t>(*in++) << shift);
+    return in;
+}
+
+template<typename T>
+inline void store(uint8_t* out, T value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+template<typename T>
+inline T load(const uint8_t* in) {
+    T value;
+    std::memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+template<typename T>
+inline void append(std::vector<uint8_t>& out, T value) {
+    size_t pos = out.size();
+    out.resize(pos + sizeof(value));
+    store(out.data() + pos, value);
+}
+
+template<typename T>
+inline void write(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Length-prefixed string
+inline void appendString(std::vector<uint8_t>& out, const std::string& str) {
+    append<uint32_t>(out, static_cast<uint32_t>(str.size()));
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+inline const uint8_t* readString(const uint8_t* in, std::string_view& str) {
+    uint32_t length = load<uint32_t>(in);
+    str = std::string_view(reinterpret_cast<const char*>(in + 4), length);
+    return in + 4 + length;
+}
+
+} // namespace BinaryIO
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef BLOCKMAXWAND_H
+#define BLOCKMAXWAND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Bm25.h"
+#include "PostingList.h"
+#include "TopKCollector.h"
+
+// Ranked disjunctive (OR) retrieval with Block-Max WAND pruning.
+//
+// Each term has an upper bound on its BM25 contribution, taken from the
+// highest frequency and shortest document in its list, and each block a
+// tighter one from its header. Documents are visited in docId order and
+// only scored when the bounds of the terms they may contain can beat the
+// weakest hit in the top-k heap; blocks that cannot are skipped without
+// being decoded. The hits kept are exactly those an exhaustive scan would
+// keep.
+class BlockMaxWand {
+public:
+    using LengthLookup = std::function<uint32_t(uint32_t)>;
+    using Filter = std::function<bool(uint32_t)>;
+
+    BlockMaxWand(const Bm25& bm25, LengthLookup documentLength);
+
+    void addTerm(const PostingListView& postings);
+
+    // Add a term whose idf is given, such as one computed over more
+    // documents than this list covers
+    void addTerm(const PostingListView& postings, double idf);
+
+    // Offer topK every document that contains at least one term, passes
+    // accept and could still rank in topK. accept is called in increasing
+    // docId order. Returns the number of documents scored; while topK is
+    // not full nothing is pruned, so that is then the number of matches.
+    size_t run(TopKCollector& topK, const Filter& accept);
+
+private:
+    struct TermCursor {
+        PostingIterator it;
+        double idf;
+        double maxScore;
+    };
+
+    const Bm25& bm25;
+    LengthLookup documentLength;
+    std::vector<TermCursor> cursors;
+
+    // Bound on the cursor's score anywhere in its current block
+    double blockBound(const TermCursor& cursor) const;
+};
+
+#endif
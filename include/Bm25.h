@@ -0,0 +1,35 @@
+#ifndef BM25_H
+#define BM25_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Okapi BM25 relevance scoring.
+//
+// IDF depends only on the term, so callers compute it once per query term
+// and pass it to score(), which is a handful of arithmetic operations per
+// (term, document) pair.
+class Bm25 {
+public:
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    Bm25(size_t documentCount, double averageDocumentLength);
+
+    // Inverse document frequency of a term found in documentFrequency documents
+    double idf(uint32_t documentFrequency) const;
+
+    // Contribution of one term occurring termFrequency times in a document
+    // of documentLength terms
+    double score(double idf, uint32_t termFrequency, uint32_t documentLength) const {
+        double tf = static_cast<double>(termFrequency);
+        return idf * tf * (K1 + 1) / (tf + lengthBase + lengthScale * documentLength);
+    }
+
+private:
+    size_t documentCount;
+    double lengthBase;   // K1 * (1 - B)
+    double lengthScale;  // K1 * B / average document length
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef DELETEDDOCS_H
+#define DELETEDDOCS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deleted documents among a segment's docIds [baseDocId, endDocId), one bit
+// per docId. Queries test every candidate against it, so contains() is a
+// shift and a mask.
+class DeletedDocs {
+public:
+    explicit DeletedDocs(uint32_t baseDocId = 0, uint32_t endDocId = 0);
+
+    bool contains(uint32_t docId) const {
+        // docIds below base wrap around and fail the range check
+        uint32_t bit = docId - base;
+        return bit < end - base && ((words[bit / 64] >> (bit % 64)) & 1) != 0;
+    }
+
+    // Whether any docId in [first, last] is deleted
+    bool containsAny(uint32_t first, uint32_t last) const;
+
+    // Mark docId deleted; false if it already was or lies outside the range
+    bool add(uint32_t docId);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t baseDocId() const { return base; }
+    uint32_t endDocId() const { return end; }
+
+    // The bits as little-endian u64 words, bit i standing for baseDocId + i
+    const std::vector<uint64_t>& bitmap() const { return words; }
+
+private:
+    uint32_t base;
+    uint32_t end;
+    std::vector<uint64_t> words;
+    size_t count;
+};
+
+#endif
@@ -1,53 +1,62 @@
 #ifndef DOCUMENT_H
 #define DOCUMENT_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 class Document {
 public:
     Document();
     Document(const std::string& filePath);
 
+    // Terms are views into the document's own buffer, so copies are not allowed
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
     // Getters
     std::string getTitle() const { return title; }
     std::string getPublication() const { return publication; }
     std::string getDatePublished() const { return datePublished; }
-    std::string getText() const;
-    std::string getProcessedText() const;
+    std::string getText() const { return text; }
     std::vector<std::string> getAuthors() const { return authors; }
     std::vector<std::string> getOrganizations() const { return organizations; }
     std::vector<std::string> getPersons() const { return persons; }
     std::string getFilePath() const { return filePath; }
-    
-    // Term frequency getter
-    int getTermFrequency(const std::string& term) const;
+    uint32_t getDocId() const { return docId; }
+
+    // Processed (stopword-filtered, stemmed) terms in document order
+    const std::vector<std::string_view>& getTerms() const { return terms; }
     
     // Setters
     void setTitle(const std::string& title) { this->title = title; }
     void setPublication(const std::string& publication) { this->publication = publication; }
     void setDatePublished(const std::string& date) { this->datePublished = date; }
-    void setText(const std::string& text);
+    void setText(const std::string& text) { this->text = text; }
     void setAuthors(const std::vector<std::string>& authors) { this->authors = authors; }
     void setOrganizations(const std::vector<std::string>& orgs) { this->organizations = orgs; }
     void setPersons(const std::vector<std::string>& persons) { this->persons = persons; }
     void setFilePath(const std::string& filePath) { this->filePath = filePath; }
-    void setProcessedText(const std::string& processedText);
+    void setTerms(std::vector<char> buffer, std::vector<std::string_view> terms);
+    void setDocId(uint32_t docId) { this->docId = docId; }
 
 private:
     std::string title;
     std::string publication;
     std::string datePublished;
     std::string text;
-    std::string originalText;
     std::vector<std::string> authors;
     std::vector<std::string> organizations;
     std::vector<std::string> persons;
     std::string filePath;
-    
-    // Store term frequencies for ranking
-    std::unordered_map<std::string, int> termFrequencies;
+
+    // Backing storage for terms; moving a vector keeps its data in place
+    std::vector<char> termBuffer;
+    std::vector<std::string_view> terms;
+
+    // ID assigned by the index, valid once the document has been indexed
+    uint32_t docId;
 };
 
-#endif 
\ No newline at end of file
+#endif
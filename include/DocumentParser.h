@@ -1,7 +1,9 @@
 #ifndef DOCUMENTPARSER_H
 #define DOCUMENTPARSER_H
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include "rapidjson/document.h"
@@ -13,14 +15,27 @@ class DocumentParser {
 public:
     DocumentParser();
 
+    // Replace the built-in stopword list
+    void setStopWords(StopWords words) { stopWords = std::move(words); }
+
     // Parse a single document
     std::unique_ptr<Document> parseDocument(const std::string& filePath);
     
-    // Parse all documents in a directory
-    std::vector<std::unique_ptr<Document>> parseDirectory(const std::string& directoryPath);
+    // Parse all documents in a directory, handing each one to sink as soon
+    // as it is parsed so the corpus is never held in memory at once.
+    // Returns the number of documents parsed.
+    size_t parseDirectory(const std::string& directoryPath,
+                          const std::function<void(std::unique_ptr<Document>)>& sink);
+
+    // Call visit with the path of every .json file under directoryPath, in
+    // walk order, until it returns false
+    static void forEachJsonFile(const std::string& directoryPath,
+                                const std::function<bool(const std::string&)>& visit);
 
-    // Process text: remove stopwords and apply stemming
-    std::string processText(const std::string& text);
+    // Process text: tokenize, remove stopwords and apply stemming. The text
+    // is copied once into buffer and terms are views into that buffer.
+    void processText(std::string_view text, std::vector<char>& buffer,
+                     std::vector<std::string_view>& terms);
 
 private:
     StopWords stopWords;
@@ -28,9 +43,6 @@ private:
 
     // Helper function to extract array from JSON
     std::vector<std::string> extractJsonArray(const rapidjson::Value& array);
-    
-    // Helper function to clean and normalize text
-    std::string cleanText(const std::string& text);
 };
 
 #endif 
\ No newline at end of file
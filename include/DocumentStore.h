@@ -0,0 +1,129 @@
+#ifndef DOCUMENTSTORE_H
+#define DOCUMENTSTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Document.h"
+#include "MappedFile.h"
+
+// Document store, kept separate from the index.
+//
+// Only the metadata shown in result lists (path, title, publication, date)
+// is kept per document. Bodies (text, authors, organizations, persons) are
+// packed into blocks of about BLOCK_BYTES, zlib-compressed, and only
+// decompressed when a full document is requested. A small LRU cache keeps
+// the most recently used blocks decompressed.
+//
+// While building, compressed blocks are spilled to an anonymous temporary
+// file as soon as they fill up, so memory holds only the metadata and the
+// block being filled no matter how large the corpus is.
+//
+// File layout (little-endian):
+//   header        { magic "SSDS", version, documentCount, blockCount }
+//   offsets       u64[documentCount + 1] into the metadata records
+//   offsets       u64[blockCount + 1] into the compressed blocks
+//   metadata      length-prefixed path, title, publication and date,
+//                 then the body's block number and slot in the block
+//   blocks        { uncompressedSize u32, zlib data }; uncompressed, a block is
+//                 { count u32, offsets u32[count + 1], records }
+class DocumentStore {
+public:
+    static constexpr uint32_t MAGIC = 0x53445353;  // "SSDS"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+    static constexpr size_t CACHE_BLOCKS = 16;
+
+    DocumentStore();
+    ~DocumentStore();
+
+    DocumentStore(const DocumentStore&) = delete;
+    DocumentStore& operator=(const DocumentStore&) = delete;
+
+    // Append a document and return its docId
+    uint32_t add(const Document& doc);
+
+    // Compress the partially filled body block
+    void flush();
+
+    // Write the store to disk; the store stays usable afterwards. filePath
+    // must not be the file a mapped store reads from.
+    bool write(const std::string& filePath);
+
+    // Map a store written by write(), replacing the current contents;
+    // false if it is missing, not a supported version, or its offset tables
+    // or metadata records reach outside the file
+    bool open(const std::string& filePath);
+    void clear();
+
+    size_t size() const;
+    bool isMapped() const { return file.isOpen(); }
+
+    // In-memory copy that can be extended; a mapped store stays mapped and
+    // readable meanwhile
+    std::unique_ptr<DocumentStore> copy() const;
+
+    // Metadata only; nullptr if docId is out of range
+    std::shared_ptr<Document> loadSummary(uint32_t docId) const;
+
+    // Full document, decompressing its body block if it isn't cached;
+    // throws std::runtime_error if the block is corrupt
+    std::shared_ptr<Document> load(uint32_t docId) const;
+
+private:
+    struct Metadata {
+        std::string filePath;
+        std::string title;
+        std::string publication;
+        std::string datePublished;
+        uint32_t block;
+        uint32_t slot;
+    };
+
+    using Block = std::vector<uint8_t>;
+
+    // Documents added since the store was created or cleared
+    std::vector<Metadata> metadata;
+
+    // Compressed blocks spilled to a temporary file; block i spans
+    // spillOffsets[i]..spillOffsets[i + 1]
+    std::FILE* spillFile;
+    std::vector<uint64_t> spillOffsets;
+
+    // Body records of the block being filled
+    std::vector<uint8_t> openRecords;
+    std::vector<uint32_t> openOffsets;
+
+    // Store mapped by open()
+    MappedFile file;
+    uint32_t mappedDocuments;
+    uint32_t mappedBlocks;
+
+    // Recently decompressed blocks, most recent first. The mutex also
+    // serializes access to the spill file.
+    mutable std::mutex cacheMutex;
+    mutable std::list<std::pair<uint32_t, std::shared_ptr<const Block>>> cache;
+
+    Metadata metadataAt(uint32_t docId) const;
+    std::string compressedBlock(uint32_t block) const;
+    size_t blockCount() const;
+    void appendBlock(const std::string& compressed);
+
+    std::shared_ptr<const Block> getBlock(uint32_t block) const;
+    Block buildOpenBlock() const;
+
+    // Copy a mapped store's metadata and compressed blocks into an empty
+    // in-memory store, keeping the block numbers
+    void copyMapped(DocumentStore& target) const;
+
+    // Copy a mapped store into memory so it can be extended
+    void detach();
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef INDEXFILE_H
+#define INDEXFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BinaryIO.h"
+#include "DeletedDocs.h"
+#include "MappedFile.h"
+#include "PostingList.h"
+#include "TermDictionary.h"
+
+// The keyed indices stored in an index file
+enum class IndexField { TERMS = 0, ORGANIZATIONS = 1, PERSONS = 2 };
+constexpr size_t INDEX_FIELD_COUNT = 3;
+
+// Binary index file, memory-mapped and queried in place.
+//
+// Layout (little-endian):
+//   header     { magic "SSIX", version, documentCount, fieldCount,
+//                lengthsOffset u64, totalDocumentLength u64,
+//                removedOffset u64, removedCount u32, reserved u32 }
+//              then per field { entriesOffset u64, dictionaryOffset u64,
+//                               suffixesOffset u64, dictionaryBytes u32,
+//                               suffixesBytes u32, flags u32 }
+//   postings   per key, its sealed posting list blocks, then its positions if
+//              the field stores them (FLAG_POSITIONS): u32 checkpoints, then
+//              the position records
+//   lengths    number of terms in each document, u32 per docId
+//   removed    if removedCount > 0, a bitmap of the docIds of removed
+//              documents, u64 words; they have no postings and length 0
+//   per field  one entry per key, in key order
+//              { postingsOffset u64, postingsBytes u32, documentCount u32,
+//                maxFrequency u32, minDocumentLength u32, positionsBytes u32 }
+//              followed by the keys as a front-coded TermDictionary, whose
+//              ordinals index the entries, and their SuffixIndex
+class IndexFile {
+public:
+    static constexpr uint32_t MAGIC = 0x58495353;  // "SSIX"
+    static constexpr uint32_t VERSION = 7;
+    static constexpr size_t FIELD_HEADER_SIZE = 36;
+    static constexpr size_t FILE_HEADER_SIZE = 48;
+    static constexpr size_t HEADER_SIZE = FILE_HEADER_SIZE + INDEX_FIELD_COUNT * FIELD_HEADER_SIZE;
+    static constexpr size_t ENTRY_SIZE = 28;
+    static constexpr uint32_t FLAG_POSITIONS = 1;
+
+    IndexFile();
+
+    // Map an index file; false if it is missing, not a supported version,
+    // or has a section or per-key entry reaching outside the file
+    bool open(const std::string& filePath);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    uint32_t documentCount() const { return documents; }
+
+    // Number of terms in a document, and in all documents together
+    uint32_t documentLength(uint32_t docId) const { return BinaryIO::load<uint32_t>(lengths + docId * 4); }
+    uint64_t totalDocumentLength() const { return totalLength; }
+
+    // Documents removed before the file was written, which keep their
+    // docIds but nothing else
+    bool isRemoved(uint32_t docId) const {
+        return removed && docId < documents &&
+               ((BinaryIO::load<uint64_t>(removed + docId / 64 * 8) >> (docId % 64)) & 1) != 0;
+    }
+    uint32_t removedCount() const { return removedDocuments; }
+
+    // Whether the field's posting lists carry term positions
+    bool hasPositions(IndexField field) const;
+
+    // Look the key up in the field's dictionary; empty view if it is absent
+    PostingListView find(IndexField field, std::string_view key) const;
+
+    // The field's sorted keys, the same keys by suffix, and the posting
+    // list of the key at an ordinal
+    const TermDictionary& dictionary(IndexField field) const;
+    const SuffixIndex& suffixes(IndexField field) const;
+    PostingListView postingsAt(IndexField field, size_t ordinal) const;
+
+private:
+    struct FieldSection {
+        const uint8_t* entries = nullptr;
+        TermDictionary keys;
+        SuffixIndex suffixes;
+        uint32_t flags = 0;
+    };
+
+    MappedFile file;
+    uint32_t documents;
+    const uint8_t* lengths;
+    uint64_t totalLength;
+    const uint8_t* removed;
+    uint32_t removedDocuments;
+    FieldSection fields[INDEX_FIELD_COUNT];
+};
+
+// Streams an index file to disk. Keys must be added in sorted order within
+// each field, and posting lists must be sealed.
+class IndexFileWriter {
+public:
+    IndexFileWriter();
+
+    bool open(const std::string& filePath);
+    void addKey(IndexField field, std::string_view key, const PostingListView& postings);
+
+    // Write the document lengths (one per docId), the removed documents
+    // (a set starting at docId 0) and the dictionaries, then patch the
+    // header
+    bool finish(const std::vector<uint32_t>& documentLengths, const DeletedDocs& removed);
+
+private:
+    struct FieldBuffer {
+        std::vector<uint8_t> entries;
+        TermDictionaryBuilder keys;
+        uint32_t flags = 0;
+    };
+
+    std::ofstream out;
+    uint64_t offset;
+    FieldBuffer fields[INDEX_FIELD_COUNT];
+};
+
+#endif
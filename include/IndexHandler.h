@@ -1,54 +1,320 @@
 #ifndef INDEXHANDLER_H
 #define INDEXHANDLER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <memory>
 #include <unordered_map>
-#include "AVLTree.h"
+#include "Bm25.h"
+#include "DeletedDocs.h"
 #include "Document.h"
+#include "DocumentStore.h"
+#include "IndexFile.h"
+#include "PostingList.h"
+#include "ProximityMatcher.h"
+#include "QueryPlan.h"
+#include "Segment.h"
+#include "StopWords.h"
+#include "TieredMergePolicy.h"
+#include "TopKCollector.h"
 
+// One page of ranked search results
+struct SearchResults {
+    std::vector<std::shared_ptr<Document>> documents;  // metadata only
+    size_t totalMatches = 0;                           // across all pages
+    bool exactTotal = true;   // false if pruning left totalMatches a lower bound
+    bool truncatedExpansion = false;  // a wildcard or fuzzy key matched too many keys
+};
+
+// Segment count and what background merges have done so far
+struct MergeStats {
+    size_t segmentCount = 0;     // published segments now
+    size_t merges = 0;           // merges completed
+    size_t segmentsMerged = 0;   // segments they replaced
+    size_t documentsMerged = 0;
+    size_t documentsRemoved = 0; // deleted documents merges dropped
+    size_t deletedDocuments = 0; // deleted documents not merged away yet
+    size_t bytesMerged = 0;      // postings and summaries rewritten
+    double mergeSeconds = 0.0;   // time spent merging, throttling included
+
+    // Merge throughput over the time spent merging
+    double bytesPerSecond() const { return mergeSeconds > 0 ? bytesMerged / mergeSeconds : 0.0; }
+};
+
+// Builds, saves and queries the indexes.
+//
+// The index is a list of immutable segments. Added documents go into an
+// in-memory SegmentBuilder; every segmentSize documents, and on
+// finalizeIndex, they are frozen into a new segment and published by
+// atomically swapping in a new snapshot of the segment list. A query reads
+// the snapshot current when it starts and holds it until it is done, so it
+// sees either all of a segment or none of it. Queries take no locks and
+// never wait for indexing, and any number of threads may run them while
+// one thread adds documents.
+//
+// A background thread keeps the segment count down: whenever a segment is
+// published it asks the TieredMergePolicy for a run of adjacent segments to
+// merge, merges them within the merge budget while queries go on, and swaps
+// the merged segment in for the run.
+//
+// Documents are deleted by marking their docIds in a bitset per segment,
+// kept in the snapshot next to the segment list and copied on write, so a
+// query sees a fixed set of deletions. Queries skip marked documents as
+// they meet them, and the next merge of the segment leaves them out. Saving
+// drops them for good. An updated document is deleted and added again
+// under a new docId.
 class IndexHandler {
 public:
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = 10000;
+    static constexpr double DEFAULT_MERGE_BYTES_PER_SECOND = 64.0 * 1024 * 1024;
+    static constexpr double DEFAULT_MERGE_CPU_SHARE = 0.5;
+
     IndexHandler();
+    ~IndexHandler();
+
+    IndexHandler(const IndexHandler&) = delete;
+    IndexHandler& operator=(const IndexHandler&) = delete;
+
+    // Also record where each term occurs, enabling phrase and NEAR queries.
+    // Call before adding documents; a loaded index keeps its own setting.
+    void setStorePositions(bool store);
+    bool hasPositions() const;
+
+    // The stopword list the documents are parsed with (the built-in list by
+    // default). It is saved with the index and restored by loadIndices, so
+    // phrase queries and later updates drop the same words the index did.
+    void setStopWords(StopWords words);
+    StopWords stopWords() const;
+
+    // Publish a segment every `documents` added documents (0 publishes only
+    // on finalizeIndex)
+    void setSegmentSize(size_t documents);
+
+    // Add a document to all indices. The document is consumed: its body goes
+    // to the document store and the parsed copy is released on return. It
+    // becomes searchable once its segment is published.
+    void addDocument(std::unique_ptr<Document> doc);
+
+    // Delete the document indexed from filePath (the last one, if the path
+    // was added more than once); false if there is none. Like an addition,
+    // the deletion takes effect once published, with the next segment or
+    // on finalizeIndex.
+    bool removeDocument(const std::string& filePath);
 
-    // Add a document to all indices
-    void addDocument(const std::unique_ptr<Document>& doc);
+    // Replace the document indexed from doc's file path by doc, or just add
+    // doc if there is none; true if one was replaced. The deletion and the
+    // addition are published together, so queries see either version but
+    // never both or neither.
+    bool updateDocument(std::unique_ptr<Document> doc);
 
-    // Save/load indices
+    // Publish the documents added since the last segment, so queries
+    // started from now on see them
+    void finalizeIndex();
+
+    // Number of published segments
+    size_t segmentCount() const;
+
+    // Which segments background merges combine, and the budget they run
+    // in: at most bytesPerSecond written (0 for no limit) and cpuShare of
+    // one core (1 for no limit). Apply from the next merge on.
+    void setMergePolicy(const TieredMergePolicy& policy);
+    void setMergeBudget(double bytesPerSecond, double cpuShare);
+
+    // Wait until the background merges have nothing left to merge
+    void waitForMerges();
+
+    MergeStats mergeStats() const;
+
+    // Save/load indices. Saving writes all segments to filePath as one
+    // index, and the document store and stopword list next to it; loading
+    // maps the index and store as a single segment instead of rebuilding
+    // trees, and falls back to the built-in stopwords if the list is
+    // missing. Deleted documents are left out of the files and the rest
+    // renumbered from docId 0, so a loaded index may number its documents
+    // differently; the index saved from keeps its own docIds.
     void saveIndices(const std::string& filePath);
     void loadIndices(const std::string& filePath);
 
-    // Search functions
+    // Search functions. Terms containing '*' or '?' (see WildcardPattern)
+    // match every indexed term they expand to, and any key ending in "~n"
+    // matches the keys within n edits (see LevenshteinAutomaton), here and
+    // in the queries below.
     std::vector<std::shared_ptr<Document>> search(const std::string& term) const;
     std::vector<std::shared_ptr<Document>> searchOrganization(const std::string& org) const;
     std::vector<std::shared_ptr<Document>> searchPerson(const std::string& person) const;
 
-    // Get relevant documents for multiple terms
+    // Full document including its text, for displaying a single result;
+    // nullptr if it was deleted. Shares a lock with addDocument, unlike the
+    // search functions.
+    std::shared_ptr<Document> loadDocument(uint32_t docId) const;
+
+    // Get relevant documents for multiple terms. Returned documents carry
+    // metadata only; use loadDocument for the full text.
     std::vector<std::shared_ptr<Document>> getRelevantDocuments(
         const std::vector<std::string>& terms,
         const std::vector<std::string>& excludedTerms,
         const std::vector<std::string>& organizations,
         const std::vector<std::string>& persons) const;
 
+    // The page of at most limit ranked results for a query plan, starting
+    // at offset. Only the best offset + limit matches are kept while
+    // scoring, and only the page itself is loaded from the document store.
+    // In MatchMode::ANY a document needs just one of the terms
+    // (organizations and persons are still required) and documents that
+    // cannot reach the page are pruned. Proximity clauses are checked
+    // against positions only for documents that pass everything else, and
+    // are ignored in segments without positions.
+    SearchResults getTopDocuments(const QueryPlan& plan, size_t limit, size_t offset = 0) const;
+
 private:
-    // AVL Trees for different indices
-    AVLTree<std::string, std::vector<std::shared_ptr<Document>>> termIndex;
-    AVLTree<std::string, std::vector<std::shared_ptr<Document>>> orgIndex;
-    AVLTree<std::string, std::vector<std::shared_ptr<Document>>> personIndex;
-
-    // Store documents to maintain their lifetime
-    std::unordered_map<std::string, std::shared_ptr<Document>> documentStore;
-
-    // Helper functions
-    void addToIndex(const std::string& key, 
-                   const std::shared_ptr<Document>& doc,
-                   AVLTree<std::string, std::vector<std::shared_ptr<Document>>>& index);
-                   
-    // Calculate TF-IDF score for ranking
-    double calculateTfIdf(const std::string& term, 
-                         const std::shared_ptr<Document>& doc,
-                         int totalDocs) const;
+    // The published segments in docId order, with totals over their live
+    // documents
+    struct Snapshot {
+        std::vector<std::shared_ptr<const Segment>> segments;
+
+        // Documents deleted from each segment since it was built, in the
+        // same order; nullptr where there are none. Replaced, never changed.
+        std::vector<std::shared_ptr<const DeletedDocs>> deletions;
+
+        size_t documentCount = 0;
+        uint64_t totalDocumentLength = 0;
+        bool positions = false;  // every segment stores positions
+        StopWords stopWords;     // the documents were parsed with
+
+        // Index of the segment holding docId; segments.size() if none does
+        size_t segmentIndex(uint32_t docId) const;
+
+        // Segment holding docId; nullptr if none does
+        const Segment* segmentFor(uint32_t docId) const;
+
+        // Whether docId was deleted, or removed by a merge
+        bool isDeleted(uint32_t docId) const;
+    };
+
+    // Posting lists built while answering one query, such as the union of
+    // the keys a wildcard or fuzzy key expands to
+    struct QueryLists {
+        std::deque<PostingList> lists;
+        bool truncated = false;  // some expansion hit its cap
+    };
+
+    // A query plan's posting lists in one segment
+    struct SegmentQuery {
+        const Segment* segment;
+        const DeletedDocs* deleted;             // nullptr if none
+        QueryLists queryLists;                  // owns expanded lists
+        std::vector<PostingListView> terms;     // in plan order
+        std::vector<PostingListView> required;  // organizations and persons
+        std::vector<PostingListView> excluded;
+    };
+
+    // Current snapshot; only read and replaced through std::atomic_load and
+    // std::atomic_store
+    std::shared_ptr<const Snapshot> snapshot;
+
+    // Writer state, guarded by writeMutex: documents added since the last
+    // published segment
+    std::mutex writeMutex;
+    SegmentBuilder builder;
+    size_t segmentSize = DEFAULT_SEGMENT_SIZE;
+    bool storePositions = false;
+
+    // Documents by docId; IDs are dense and assigned in addDocument. Also
+    // guarded by storeMutex, which loadDocument takes. After loadIndices the
+    // loaded segment reads its summaries from the same mapped store, so the
+    // first added document switches to an in-memory copy instead of
+    // changing it.
+    std::shared_ptr<DocumentStore> documentStore;
+    mutable std::mutex storeMutex;
+
+    // Deleted docIds waiting for the next publishSegment
+    std::vector<uint32_t> pendingDeletions;
+
+    // Map file path to the docId of its live document. After loadIndices
+    // it is only filled from the loaded segment once a deletion needs it.
+    std::unordered_map<std::string, uint32_t> documentIds;
+    bool documentIdsComplete = true;
+
+    // Background merges. The merger thread starts with the first published
+    // segment; the fields below are guarded by mergeMutex, which may be
+    // taken while holding writeMutex but not the other way round.
+    std::thread merger;
+    mutable std::mutex mergeMutex;
+    std::condition_variable mergeWake;   // segments published, or stopping
+    std::condition_variable mergeIdle;   // nothing left to merge
+    bool mergeRequested = false;
+    bool merging = false;
+    std::atomic<bool> stopMerging{false};
+    TieredMergePolicy mergePolicy;
+    double mergeBytesPerSecond = DEFAULT_MERGE_BYTES_PER_SECOND;
+    double mergeCpuShare = DEFAULT_MERGE_CPU_SHARE;
+    MergeStats stats;
+
+    std::shared_ptr<const Snapshot> currentSnapshot() const;
+
+    // Freeze the builder's documents into a segment and publish it with the
+    // pending deletions; the caller holds writeMutex
+    void publishSegment();
+
+    // addDocument and removeDocument for a caller holding writeMutex
+    void indexDocument(std::unique_ptr<Document> doc);
+    bool deleteDocument(const std::string& filePath);
+
+    // Fill documentIds from the published segments if loadIndices left it
+    // empty; the caller holds writeMutex
+    void completeDocumentIds();
+
+    // Mark the pending deletions in next, copying each bitset it changes
+    void applyDeletions(Snapshot& next);
+
+    // Merger thread: run merges until the policy finds none, then wait for
+    // the next published segment
+    void mergeLoop();
+
+    // Run one merge the policy asks for and swap its result in; false if
+    // there was nothing to merge or merging stopped
+    bool mergeOnce();
+
+    // Posting list of a query key in a segment: a plain key's own list, or
+    // the union of the keys a fuzzy key (any field) or wildcard pattern
+    // (terms only) expands to, kept in lists
+    PostingListView findQueryPostings(const Segment& segment, IndexField field, const std::string& key,
+                                      QueryLists& lists) const;
+
+    // Merge posting lists into one, adding up frequencies of shared documents
+    PostingList unionPostings(const Segment& segment, const std::vector<PostingListView>& postings) const;
+
+    // Look up the docIds of a key in every segment, in order
+    std::vector<std::shared_ptr<Document>> searchField(IndexField field, const std::string& key) const;
+
+    // Append the sorted docIds of a posting list, leaving out deleted ones
+    static void collectDocIds(const PostingListView& postings, const DeletedDocs* deleted,
+                              std::vector<uint32_t>& docIds);
+
+    // Offer topK the matches in one segment, scored with idfs from the whole
+    // index; return the number of documents matched (ALL) or scored (ANY)
+    size_t rankAll(SegmentQuery& query, const QueryPlan& plan, const Bm25& bm25,
+                   const std::vector<double>& idfs, TopKCollector& topK) const;
+    size_t rankAny(SegmentQuery& query, const QueryPlan& plan, const Bm25& bm25,
+                   const std::vector<double>& idfs, TopKCollector& topK) const;
+
+    // One matcher per clause, or none if the segment stores no positions
+    std::vector<ProximityMatcher> makeMatchers(const Segment& segment,
+                                               const std::vector<ProximityClause>& proximities) const;
+
+    // The page of ranked hits starting at offset
+    SearchResults resolvePage(const Snapshot& current, const std::vector<ScoredDoc>& ranked,
+                              size_t offset) const;
+
+    // Resolve docIds to documents
+    std::vector<std::shared_ptr<Document>> resolveDocuments(const Snapshot& current,
+                                                            const std::vector<uint32_t>& docIds) const;
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -0,0 +1,46 @@
+#ifndef INGESTPIPELINE_H
+#define INGESTPIPELINE_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include "Document.h"
+#include "StopWords.h"
+
+// Multi-threaded directory ingestion.
+//
+// A walker thread lists the JSON files and feeds a bounded queue, worker
+// threads (each with its own DocumentParser) parse and process them, and
+// the calling thread hands the results to the sink in directory order.
+// Because documents arrive in the same order as a serial parseDirectory,
+// they get the same docIds and the resulting index is identical.
+//
+// Memory is bounded by queueCapacity: a worker holds its result until its
+// sequence is below nextSequence + queueCapacity, so the reorder buffer and
+// the results queue each hold fewer than queueCapacity documents, plus one
+// in flight per worker, however slow a single file is to parse.
+class IngestPipeline {
+public:
+    using Sink = std::function<void(std::unique_ptr<Document>)>;
+
+    // threadCount of 0 uses one worker per hardware thread
+    explicit IngestPipeline(size_t threadCount, size_t queueCapacity = 256);
+
+    // Parse every JSON file under directoryPath and pass each document to
+    // sink; returns the number of documents delivered
+    size_t run(const std::string& directoryPath, const Sink& sink);
+
+    size_t getThreadCount() const { return threadCount; }
+
+    // Stopword list used by every worker (the built-in list by default)
+    void setStopWords(StopWords words) { stopWords = std::move(words); }
+
+private:
+    size_t threadCount;
+    size_t queueCapacity;
+    StopWords stopWords;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef LEVENSHTEINAUTOMATON_H
+#define LEVENSHTEINAUTOMATON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TermDictionary.h"
+
+// Accepts the keys within maxDistance edits (insertions, deletions or
+// substitutions, ignoring ASCII case) of a word, for fuzzy terms such as
+// "zuckerburg~1".
+//
+// The automaton state after reading a prefix is one row of the edit
+// distance table, capped at maxDistance + 1. It is run over a dictionary in
+// key order: rows for the prefix a key shares with the previous one are
+// reused, and once a prefix's row exceeds maxDistance everywhere no key
+// starting with it can match, so the whole range of such keys is skipped.
+// Only the small part of the dictionary near the word is ever decoded.
+class LevenshteinAutomaton {
+public:
+    static constexpr uint32_t MAX_DISTANCE = 2;
+    static constexpr size_t MAX_EXPANSIONS = 128;
+
+    LevenshteinAutomaton(std::string_view word, uint32_t maxDistance);
+
+    // Split a fuzzy query term "word~n" (n defaults to, and is capped at,
+    // MAX_DISTANCE); false if term has no trailing "~" or "~n"
+    static bool parse(std::string_view term, std::string& word, uint32_t& maxDistance);
+
+    // Edit distance from the word, or maxDistance + 1 if it is larger
+    uint32_t distance(std::string_view key) const;
+
+    // Ordinals of matching keys in increasing order. If more than
+    // MAX_EXPANSIONS keys match, the closest ones are kept and truncated is
+    // set.
+    std::vector<size_t> expand(const TermDictionary& keys, bool& truncated) const;
+
+private:
+    std::string word;
+    uint32_t maxDistance;
+
+    // Row for prefix + c from the row for prefix; false if it is dead
+    bool step(const uint8_t* row, uint8_t* next, char c) const;
+};
+
+#endif
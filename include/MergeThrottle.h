@@ -0,0 +1,44 @@
+#ifndef MERGETHROTTLE_H
+#define MERGETHROTTLE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+// Paces a background merge so it stays within an I/O and a CPU budget.
+//
+// The merge reports the bytes it writes through pace(), which sleeps once
+// the merge is ahead of bytesPerSecond, or once it has been busy for more
+// than cpuShare of the time since it started. Work is checked in chunks of
+// CHECK_BYTES, so small keys cost no clock reads. A merge that is no longer
+// wanted can be cancelled through the flag, which pace() also checks.
+class MergeThrottle {
+public:
+    static constexpr size_t CHECK_BYTES = 64 * 1024;
+
+    // bytesPerSecond of 0 and cpuShare of 1 or more set no limit; cancelled
+    // may be nullptr
+    MergeThrottle(double bytesPerSecond, double cpuShare,
+                  const std::atomic<bool>* cancelled = nullptr);
+
+    // Account for bytes just written and sleep as long as the budgets need;
+    // false if the merge has been cancelled
+    bool pace(size_t bytes);
+
+    // Bytes reported so far
+    size_t bytesWritten() const { return total; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    double bytesPerSecond;
+    double cpuShare;
+    const std::atomic<bool>* cancelled;
+
+    Clock::time_point start;
+    Clock::duration slept;
+    size_t total;
+    size_t unchecked;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Slab allocator for the nodes of a tree that only grows.
+//
+// Nodes are constructed in place in slabs of SLAB_NODES and are never freed
+// one at a time: clear() destroys them all by sweeping the slabs in
+// allocation order and releases the memory in one go. For trivially
+// destructible nodes that is just freeing the slabs.
+template<typename T>
+class NodePool {
+public:
+    static constexpr size_t SLAB_NODES = 256;
+
+    NodePool() : used(SLAB_NODES), count(0) {}
+    ~NodePool() { clear(); }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        if (used == SLAB_NODES) {
+            slabs.emplace_back(new Slot[SLAB_NODES]);
+            used = 0;
+        }
+        T* node = new (&slabs.back()[used]) T(std::forward<Args>(args)...);
+        used++;
+        count++;
+        return node;
+    }
+
+    // Destroy every node and free the slabs
+    void clear() {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (size_t i = 0; i < slabs.size(); ++i) {
+                size_t nodes = i + 1 < slabs.size() ? SLAB_NODES : used;
+                for (size_t j = 0; j < nodes; ++j) {
+                    reinterpret_cast<T*>(&slabs[i][j])->~T();
+                }
+            }
+        }
+        slabs.clear();
+        used = SLAB_NODES;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+
+private:
+    struct alignas(T) Slot {
+        unsigned char bytes[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    size_t used;   // nodes constructed in the last slab
+    size_t count;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef POSTINGLIST_H
+#define POSTINGLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DeletedDocs.h"
+
+// One entry in a posting list: a document ID and how often the key occurs in it
+struct Posting {
+    uint32_t docId;
+    uint32_t frequency;
+};
+
+// Sequential decoder over an encoded posting list.
+//
+// The iterator starts on the first posting. docId() returns END once the
+// list is exhausted, so callers can loop with "while (it.docId() != END)".
+class PostingIterator {
+public:
+    static constexpr uint32_t END = UINT32_MAX;
+
+    // data/size are encoded blocks; pending is an optional unencoded tail of
+    // interleaved (docId, frequency) pairs that follows the last block
+    PostingIterator(const uint8_t* data, size_t size,
+                    const uint32_t* pending = nullptr, size_t pendingCount = 0);
+
+    uint32_t docId() const { return currentDoc; }
+    uint32_t frequency() const;
+
+    // Index of the current posting within the list, for looking up its
+    // positions
+    size_t ordinal() const { return blockBase + position; }
+
+    // Move to the next posting and return its docId (END when exhausted)
+    uint32_t next();
+
+    // Move to the first posting with docId >= target and return its docId.
+    // Whole blocks are skipped using their headers without being decoded.
+    uint32_t advance(uint32_t target);
+
+    // Move only the block bounds below to the block that would hold target,
+    // reading headers but decoding nothing. The next move must then be
+    // advance() to target or beyond.
+    void shallowAdvance(uint32_t target);
+
+    // Bounds of the block under the iterator (or reached by shallowAdvance):
+    // its last docId, highest frequency and shortest document length.
+    // blockLastDocId() is END past the end of the list.
+    uint32_t blockLastDocId() const { return boundLastDoc; }
+    uint32_t blockMaxFrequency() const { return boundMaxFrequency; }
+    uint32_t blockMinDocumentLength() const { return boundMinLength; }
+
+private:
+    const uint8_t* cursor;
+    const uint8_t* end;
+    const uint32_t* pending;
+    size_t pendingCount;
+    bool inPending;
+
+    // Decoded copy of the current block
+    uint32_t docIds[128];
+    uint32_t frequencies[128];
+    size_t blockCount;
+    size_t position;
+    uint32_t currentDoc;
+
+    // Bounds of the current (or shallow) block
+    uint32_t boundLastDoc;
+    uint32_t boundMaxFrequency;
+    uint32_t boundMinLength;
+
+    // Ordinals of the decoded block's first posting and of the block at cursor
+    size_t blockBase;
+    size_t nextBase;
+
+    bool loadNextBlock();
+    void loadPending();
+    void readBounds(const uint8_t* header);
+    void readPendingBounds();
+};
+
+// Read-only view of an encoded posting list, either owned by a PostingList
+// or pointing into a mapped index file
+struct PostingListView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const uint32_t* pending = nullptr;
+    size_t pendingCount = 0;
+    size_t documentCount = 0;
+
+    // Highest frequency and shortest document length over the whole list
+    uint32_t maxFrequency = 0;
+    uint32_t minDocumentLength = 0;
+
+    // Position data, if the list stores positions: one u32 checkpoint per
+    // POSITION_INTERVAL postings, then the position records
+    const uint8_t* positionCheckpoints = nullptr;
+    const uint8_t* positionData = nullptr;
+    size_t positionSize = 0;
+
+    bool empty() const { return documentCount == 0; }
+    bool hasPositions() const { return positionData != nullptr && positionSize > 0; }
+    PostingIterator iterator() const { return PostingIterator(data, size, pending, pendingCount); }
+
+    // Decode the term positions of the posting at ordinal into out, in
+    // increasing order; false if the list stores no positions
+    bool positions(size_t ordinal, std::vector<uint32_t>& out) const;
+};
+
+// Compressed posting list.
+//
+// Postings are grouped in blocks of up to BLOCK_SIZE documents. Each block
+// starts with a fixed header
+//   { firstDocId u32, lastDocId u32, payloadBytes u32, count u8,
+//     maxFrequency u32, minDocumentLength u32 }
+// followed by the docId gaps and the frequencies, all variable-byte encoded.
+// The header doubles as the skip pointer: a reader looking for a docId past
+// lastDocId jumps payloadBytes ahead without decoding anything. The
+// frequency and length bounds give an upper bound on any score in the block.
+//
+// Documents must be added in increasing docId order. The last, partially
+// filled block is kept unencoded so frequencies can still be bumped.
+//
+// A list can also store where in each document the key occurs. Each
+// posting's positions are a 0x00 marker followed by the first position + 1
+// and then the gaps between positions, all variable-byte encoded and
+// nonzero, so a 0x00 byte only ever starts a record. A checkpoint every
+// POSITION_INTERVAL postings keeps lookups to a short memchr walk.
+class PostingList {
+public:
+    static constexpr size_t BLOCK_SIZE = 128;
+    static constexpr size_t HEADER_SIZE = 21;
+    static constexpr size_t POSITION_INTERVAL = 128;
+
+    PostingList();
+
+    // Record one occurrence of the key in docId (docId >= last added docId),
+    // a document of documentLength terms
+    void add(uint32_t docId, uint32_t documentLength);
+
+    // Append a posting with a known frequency (docId > last added docId)
+    void append(uint32_t docId, uint32_t frequency, uint32_t documentLength);
+
+    // Record a position of the key in the last added document. Positions
+    // must increase within a document, and either every posting of a list
+    // gets positions or none does.
+    void addPosition(uint32_t position);
+
+    // Append a whole list whose docIds all follow this list's, such as the
+    // same key's list in the next segment, leaving out documents in
+    // deleted. Its full blocks and position records are copied as they
+    // are; only a short last block, or one holding a deleted document, is
+    // decoded. Positions are copied if withPositions is set, which requires
+    // both lists to store them.
+    void appendList(const PostingListView& postings, bool withPositions,
+                    const DeletedDocs* deleted = nullptr);
+
+    // Number of documents in the list
+    size_t size() const { return documentCount; }
+    bool empty() const { return documentCount == 0; }
+
+    // Highest docId in the list (only valid if not empty)
+    uint32_t lastDocId() const { return lastDoc; }
+
+    PostingIterator iterator() const;
+    PostingListView view() const;
+
+    // Bytes held by the encoded blocks and the pending tail
+    size_t memoryUsage() const;
+
+    // Encode the pending tail as a final (possibly short) block
+    void seal();
+
+private:
+    std::vector<uint8_t> blocks;
+    std::vector<uint32_t> pending;
+    size_t documentCount;
+    uint32_t lastDoc;
+
+    // Bounds over the encoded blocks, and the shortest pending document
+    uint32_t maxFrequency;
+    uint32_t minLength;
+    uint32_t pendingMinLength;
+
+    // Position records, their checkpoints, and how many postings have one
+    std::vector<uint8_t> positionData;
+    std::vector<uint32_t> positionCheckpoints;
+    size_t positionedCount;
+    uint32_t lastPosition;
+
+    void flushBlock();
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef PROXIMITYMATCHER_H
+#define PROXIMITYMATCHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PostingList.h"
+
+// A positional constraint on query terms: an exact phrase, or two terms
+// within a given distance of each other in either order
+struct ProximityClause {
+    enum class Kind { PHRASE, NEAR };
+
+    Kind kind = Kind::PHRASE;
+    std::vector<std::string> terms;  // stemmed; NEAR has exactly two
+    uint32_t distance = 0;           // NEAR: most positions apart
+};
+
+// Checks a clause against candidate documents using stored positions.
+// It keeps its own iterators, so candidates must come in increasing docId
+// order; positions are only decoded for documents containing every term.
+class ProximityMatcher {
+public:
+    // postings holds one list per clause term, in clause order
+    ProximityMatcher(const ProximityClause& clause, const std::vector<PostingListView>& postings);
+
+    bool matches(uint32_t docId);
+
+private:
+    ProximityClause::Kind kind;
+    uint32_t distance;
+    std::vector<PostingListView> lists;
+    std::vector<PostingIterator> iterators;
+
+    // Decoded positions per term, and phrase start candidates
+    std::vector<std::vector<uint32_t>> positions;
+    std::vector<uint32_t> starts;
+
+    bool matchPhrase();
+    bool matchNear() const;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef QUERYPLAN_H
+#define QUERYPLAN_H
+
+#include <string>
+#include <vector>
+#include "ProximityMatcher.h"
+
+// How query terms combine: every term must match, or any one of them
+enum class MatchMode { ALL, ANY };
+
+// A parsed query, ready to run against an index. Keys are stemmed and
+// normalized the way the index stores them; wildcard and fuzzy keys keep
+// their "*", "?" or "~n". QueryProcessor::parse builds a plan and nothing
+// changes it afterwards, so one plan can be run by any number of threads.
+struct QueryPlan {
+    std::vector<std::string> terms;          // scored
+    std::vector<std::string> excludedTerms;  // matching documents are dropped
+    std::vector<std::string> organizations;  // required, not scored
+    std::vector<std::string> persons;        // required, not scored
+    MatchMode matchMode = MatchMode::ALL;    // ANY if the query uses OR
+    std::vector<ProximityClause> proximities;  // quoted phrases and NEAR/n
+
+    // Whether nothing would be matched
+    bool empty() const { return terms.empty() && organizations.empty() && persons.empty(); }
+};
+
+#endif
@@ -6,35 +6,51 @@
 #include <memory>
 #include "IndexHandler.h"
 #include "Document.h"
+#include "QueryPlan.h"
 #include "Stemmer.h"
 
+// Turns query strings into query plans and runs them. Parsing and
+// searching are const and keep no per-query state, so one processor can
+// serve many threads at once; only processQuery talks to the console.
 class QueryProcessor {
 public:
-    QueryProcessor(IndexHandler* indexHandler);
+    QueryProcessor(const IndexHandler* indexHandler);
 
-    // Process a query and return results
-    std::vector<std::shared_ptr<Document>> processQuery(const std::string& queryString);
+    // Results shown per page
+    static constexpr size_t PAGE_SIZE = 15;
 
-    // Display results to console
-    void displayResults(const std::vector<std::shared_ptr<Document>>& results);
-    void displayDocument(const std::shared_ptr<Document>& doc);
+    // Process a query, let the user page through the results, and return
+    // the first page
+    std::vector<std::shared_ptr<Document>> processQuery(const std::string& queryString) const;
+
+    // Parse a query string into a plan
+    QueryPlan parse(const std::string& queryString) const;
+
+    // One page of ranked results, without any console input or output
+    SearchResults search(const QueryPlan& plan, size_t limit, size_t offset = 0) const;
+    SearchResults search(const std::string& queryString, size_t limit, size_t offset = 0) const;
+
+    // Display one page of results to console; returns true if the user
+    // asked for the next page
+    bool displayResults(const SearchResults& results, size_t offset) const;
+    void displayDocument(const std::shared_ptr<Document>& result) const;
 
 private:
-    IndexHandler* indexHandler;
+    const IndexHandler* indexHandler;
 
-    // Query components
-    std::vector<std::string> terms;
-    std::vector<std::string> excludedTerms;
-    std::vector<std::string> organizations;
-    std::vector<std::string> persons;
+    // Add the words of a quoted phrase to plan as terms plus a phrase clause,
+    // dropping the stopwords the index was built with
+    void addPhrase(const std::string& phrase, QueryPlan& plan) const;
 
-    // Parse query string into components
-    void parseQuery(const std::string& queryString);
+    // Stemmed form of a query word, or the normalized pattern if it has
+    // wildcards (patterns match stemmed terms and are not stemmed themselves).
+    // A fuzzy word "word~n" is stemmed and keeps its "~n".
+    std::string queryTerm(const std::string& token) const;
 
-    // Clear previous query components
-    void clearQueryComponents();
+    // Whether a query term stands for several indexed terms
+    static bool isExpanded(const std::string& term);
 
     Stemmer stemmer;
 };
 
-#endif 
\ No newline at end of file
+#endif
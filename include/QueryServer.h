@@ -0,0 +1,65 @@
+#ifndef QUERYSERVER_H
+#define QUERYSERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "IndexHandler.h"
+#include "QueryProcessor.h"
+
+// Answers queries over HTTP on localhost from an index loaded once.
+//
+//   GET /search?q=<query>&k=<count>&offset=<n>
+//
+// k is capped at MAX_RESULTS, and requests reaching past MAX_PAGE_DEPTH
+// (offset + k) are refused with 400, since every hit up to the end of the
+// page has to be ranked and a deep page would switch off WAND pruning.
+//
+// returns the ranked hits as JSON:
+//
+//   {"query": "...", "total": 42, "exactTotal": true,
+//    "truncatedExpansion": false,
+//    "hits": [{"rank": 1, "docId": 7, "title": "...", "publication": "...",
+//              "date": "...", "path": "..."}, ...]}
+//
+// The calling thread accepts connections and hands them to a fixed pool of
+// worker threads through a bounded queue. The workers share one
+// QueryProcessor and run queries on the index's current snapshot without
+// locks, so documents may be added to the index while it serves.
+// Connections are kept alive between requests until the client closes them
+// or stays idle for IDLE_TIMEOUT_SECONDS.
+class QueryServer {
+public:
+    static constexpr size_t DEFAULT_RESULTS = 10;
+    static constexpr size_t MAX_RESULTS = 1000;
+    static constexpr size_t MAX_PAGE_DEPTH = 10000;
+    static constexpr size_t MAX_REQUEST_BYTES = 16 * 1024;
+    static constexpr int IDLE_TIMEOUT_SECONDS = 5;
+
+    // threadCount of 0 uses one worker per hardware thread
+    QueryServer(const IndexHandler* indexHandler, size_t threadCount);
+
+    size_t getThreadCount() const { return threadCount; }
+
+    // Listen on 127.0.0.1:port and serve until stop() is called; throws
+    // std::runtime_error if the port can't be bound
+    void serve(uint16_t port);
+
+    // Stop accepting connections; serve() returns once the workers are done
+    void stop();
+
+private:
+    QueryProcessor processor;
+    size_t threadCount;
+    std::atomic<int> listenSocket;
+    std::atomic<bool> stopping;
+
+    // Answer requests on one connection until it is closed
+    void handleConnection(int client) const;
+
+    // Status code and JSON body answering one request
+    std::string respond(const std::string& method, const std::string& target, int& status) const;
+};
+
+#endif
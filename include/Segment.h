@@ -0,0 +1,165 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AVLTree.h"
+#include "DeletedDocs.h"
+#include "Document.h"
+#include "DocumentStore.h"
+#include "IndexFile.h"
+#include "MergeThrottle.h"
+#include "PostingList.h"
+#include "TermDictionary.h"
+
+// One immutable part of the index: the documents with docIds in
+// [baseDocId, endDocId), the keys of each field with their posting lists,
+// the documents' lengths and the summaries shown in result lists.
+//
+// A segment is either frozen in memory by a SegmentBuilder or maps an index
+// file written by write(). Posting lists hold global docIds, so segments
+// never share a document and a query can run over each one in turn. Nothing
+// changes a segment once it exists, so any number of threads may read it.
+//
+// Documents deleted after a segment was built are tracked outside it (see
+// DeletedDocs) and only leave it when it is merged. The merged segment keeps
+// their docIds as removed documents: no postings, length 0 and no summary.
+class Segment {
+public:
+    // Map an index file as a segment starting at docId 0, reading summaries
+    // from store, the document store written with it; throws
+    // std::runtime_error if the file can't be read or doesn't match store
+    static std::shared_ptr<const Segment> open(const std::string& filePath,
+                                               std::shared_ptr<const DocumentStore> store);
+
+    // One segment holding the documents of segments, which must be given in
+    // docId order and follow each other without gaps. deletions, if not
+    // empty, holds the documents deleted from each segment (or nullptr),
+    // which are removed from the merged one. The work is paced by throttle
+    // if given; nullptr if the throttle cancelled the merge.
+    static std::shared_ptr<const Segment> merge(
+        const std::vector<std::shared_ptr<const Segment>>& segments,
+        const std::vector<std::shared_ptr<const DeletedDocs>>& deletions = {},
+        MergeThrottle* throttle = nullptr);
+
+    // The live documents of segment renumbered from docId 0 in the same
+    // order, leaving out the removed ones; their posting lists are decoded
+    // and encoded again under the new docIds
+    static std::shared_ptr<const Segment> compact(const Segment& segment);
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    uint32_t baseDocId() const { return base; }
+    uint32_t endDocId() const { return end; }
+    size_t documentCount() const { return end - base; }
+    uint64_t totalDocumentLength() const { return totalLength; }
+    uint32_t documentLength(uint32_t docId) const;
+
+    // Documents removed when the segment was merged or written; the live
+    // documents are the others
+    bool isRemoved(uint32_t docId) const;
+    size_t removedCount() const;
+    size_t liveDocumentCount() const { return documentCount() - removedCount(); }
+
+    // Whether term posting lists carry positions
+    bool hasPositions() const { return positions; }
+
+    // The field's sorted keys, the same keys by suffix, and the posting
+    // list of the key at an ordinal
+    const TermDictionary& dictionary(IndexField field) const;
+    const SuffixIndex& suffixes(IndexField field) const;
+    PostingListView postingsAt(IndexField field, size_t ordinal) const;
+
+    // Posting list of a key; empty view if it is absent
+    PostingListView find(IndexField field, std::string_view key) const;
+
+    // Metadata of a document in the segment; nullptr if it was removed
+    std::shared_ptr<Document> loadSummary(uint32_t docId) const;
+
+    // Write the postings, lengths and removed documents as an index file
+    // (not the document store); the segment must start at docId 0
+    bool write(const std::string& filePath) const;
+
+private:
+    friend class SegmentBuilder;
+
+    // A field of an in-memory segment: its keys in a front-coded dictionary
+    // and their posting lists in the same order
+    struct Field {
+        TermDictionary keys;
+        SuffixIndex suffixes;
+        std::vector<PostingList> postings;
+    };
+
+    // What a result list shows of a document in an in-memory segment
+    struct Summary {
+        std::string filePath;
+        std::string title;
+        std::string publication;
+        std::string datePublished;
+    };
+
+    uint32_t base;
+    uint32_t end;
+    uint64_t totalLength;
+    bool positions;
+
+    // Mapped segment
+    IndexFile file;
+    std::shared_ptr<const DocumentStore> store;
+
+    // In-memory segment
+    Field fields[INDEX_FIELD_COUNT];
+    std::vector<uint32_t> lengths;
+    std::vector<Summary> summaries;
+    DeletedDocs removed;
+
+    Segment();
+
+    // Turn sorted keys and their sealed posting lists into a field
+    static void buildField(Field& field, TermDictionaryBuilder& keys);
+};
+
+// Collects added documents into AVL trees until they are frozen into an
+// in-memory Segment. Only the thread adding documents touches a builder.
+class SegmentBuilder {
+public:
+    explicit SegmentBuilder(uint32_t baseDocId = 0, bool storePositions = false);
+
+    // Index a document; docIds must follow each other from baseDocId
+    void add(uint32_t docId, const Document& doc);
+
+    uint32_t baseDocId() const { return base; }
+    size_t documentCount() const { return lengths.size(); }
+    bool empty() const { return lengths.empty(); }
+
+    // Freeze the documents added so far into a segment and start a new one
+    // after them
+    std::shared_ptr<const Segment> build();
+
+    // Drop the documents added so far and start over at baseDocId
+    void reset(uint32_t baseDocId, bool storePositions);
+
+private:
+    uint32_t base;
+    bool storePositions;
+
+    AVLTree<std::string, PostingList> termIndex;
+    AVLTree<std::string, PostingList> orgIndex;
+    AVLTree<std::string, PostingList> personIndex;
+
+    std::vector<uint32_t> lengths;
+    uint64_t totalLength;
+    std::vector<Segment::Summary> summaries;
+
+    void addToIndex(const std::string& key, uint32_t docId, uint32_t length,
+                    AVLTree<std::string, PostingList>& index);
+    AVLTree<std::string, PostingList>& treeFor(IndexField field);
+};
+
+#endif
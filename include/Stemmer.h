@@ -1,34 +1,36 @@
 #ifndef STEMMER_H
 #define STEMMER_H
 
+#include <cstddef>
 #include <string>
 
+// Porter-style suffix stripping that works in place on a char buffer.
+// Every rule replaces a suffix with one no longer than itself, so stemming
+// never needs more room than the word already has and never allocates.
 class Stemmer {
 public:
     Stemmer() = default;
     
-    // Main stemming function
-    std::string stemWord(const std::string& word);
+    // Main stemming function (words of 2 characters or fewer are returned as is)
+    std::string stemWord(const std::string& word) const;
+
+    // Stem the lowercase word in word[0, length) in place and return the new
+    // length
+    size_t stem(char* word, size_t length) const;
 
 private:
-    // Helper functions for Porter stemming algorithm
-    bool isConsonant(const std::string& str, int i);
-    int countConsonantSequences(const std::string& str);
-    bool containsVowel(const std::string& str);
-    bool endsWithDoubleConsonant(const std::string& str);
-    bool endsWithCVC(const std::string& str);
-    
-    // Step functions for Porter algorithm
-    std::string step1a(const std::string& str);
-    std::string step1b(const std::string& str);
-    std::string step1c(const std::string& str);
-    std::string step2(const std::string& str);
-    std::string step3(const std::string& str);
-    std::string step4(const std::string& str);
-    std::string step5(const std::string& str);
+    // Helpers for the Porter algorithm over the prefix word[0, length)
+    static int countConsonantSequences(const char* word, size_t length);
+    static bool containsVowel(const char* word, size_t length);
     
-    // Helper to replace endings
-    std::string replaceEnding(const std::string& str, const std::string& oldEnd, const std::string& newEnd);
+    // Step functions for Porter algorithm; each returns the new length
+    static size_t step1a(char* word, size_t length);
+    static size_t step1b(char* word, size_t length);
+    static size_t step1c(char* word, size_t length);
+    static size_t step2(char* word, size_t length);
+    static size_t step3(char* word, size_t length);
+    static size_t step4(char* word, size_t length);
+    static size_t step5(char* word, size_t length);
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -1,18 +1,55 @@
 #ifndef STOPWORDS_H
 #define STOPWORDS_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+#include <vector>
 
+// Stopword matcher backed by a minimal-probe perfect hash table.
+//
+// Each word hashes to a bucket, and each bucket has a seed chosen so that
+// every word in the table lands in a slot of its own. A lookup is one hash
+// over the (lowercased) word, one slot and one compare, with no allocation.
+// The built-in English list is laid out at compile time; custom lists are
+// laid out the same way when they are loaded.
 class StopWords {
 public:
+    // Built-in English list
     StopWords();
+
+    // Custom list; words are matched case-insensitively, duplicates are fine
+    explicit StopWords(const std::vector<std::string>& words);
+
+    // Load a custom list with one word per line; blank lines and lines
+    // starting with '#' are skipped. Throws std::runtime_error if the file
+    // cannot be read.
+    static StopWords fromFile(const std::string& path);
+
+    // Write the list in the format fromFile reads; false on failure
+    bool write(const std::string& path) const;
     
-    bool isStopWord(const std::string& word) const;
+    bool isStopWord(std::string_view word) const;
+
+    size_t size() const { return count; }
+
+    // The words, lowercased and sorted
+    std::vector<std::string> words() const;
 
 private:
-    std::unordered_set<std::string> stopWordsSet;
-    void loadDefaultStopWords();
+    struct CustomTable;
+
+    const uint32_t* seeds;
+    const std::string_view* slots;
+    size_t bucketMask;
+    size_t slotMask;
+    size_t count;
+    size_t maxLength;
+
+    // Owns the layout of a custom list; shared between copies
+    std::shared_ptr<const CustomTable> custom;
 };
 
-#endif 
\ No newline at end of file
+#endif
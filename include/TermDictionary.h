@@ -0,0 +1,160 @@
+#ifndef TERMDICTIONARY_H
+#define TERMDICTIONARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable sorted set of keys, each identified by its ordinal (its rank in
+// key order), front-coded so that a whole dictionary is one compact byte
+// array that can be built in memory or queried straight from a mapped file.
+//
+// Keys are grouped in blocks of BLOCK_SIZE. Every key is stored as the
+// length of the prefix it shares with the previous key, then the remaining
+// suffix; the first key of a block shares nothing, so each block can be
+// decoded on its own. A lookup binary searches the block heads, then walks
+// one block comparing only the suffixes, without rebuilding any key.
+//
+// Layout (little-endian):
+//   { keyCount u32, blockCount u32, blockOffsets u32[blockCount] }
+//   then per key { sharedLength varint, suffixLength varint, suffix bytes }
+class TermDictionary {
+public:
+    static constexpr size_t BLOCK_SIZE = 16;
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    TermDictionary();
+
+    // Take ownership of bytes produced by TermDictionaryBuilder::finish()
+    explicit TermDictionary(std::vector<uint8_t> encoded);
+
+    TermDictionary(const TermDictionary&) = delete;
+    TermDictionary& operator=(const TermDictionary&) = delete;
+    TermDictionary(TermDictionary&& other) noexcept;
+    TermDictionary& operator=(TermDictionary&& other) noexcept;
+
+    // Read a dictionary whose bytes are owned elsewhere (e.g. a mapped
+    // file); false if they don't hold a valid header
+    bool open(const uint8_t* data, size_t size);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Bytes of the encoded form
+    size_t encodedSize() const { return length; }
+
+    // Ordinal of key, or NOT_FOUND
+    size_t find(std::string_view key) const;
+
+    // Ordinal of the first key >= key, or size() if there is none
+    size_t lowerBound(std::string_view key) const;
+
+    std::string keyAt(size_t ordinal) const;
+
+    // Forward iteration in key order from a given ordinal
+    class Cursor {
+    public:
+        bool valid() const { return index < count; }
+        size_t ordinal() const { return index; }
+        std::string_view key() const { return current; }
+        void next();
+
+    private:
+        friend class TermDictionary;
+        Cursor(const TermDictionary& dictionary, size_t ordinal);
+
+        const uint8_t* in;
+        size_t index;
+        size_t count;
+        std::string current;
+
+        void decode();
+    };
+
+    Cursor cursor(size_t ordinal = 0) const { return Cursor(*this, ordinal); }
+
+    // Visit (key, ordinal) for every key starting with prefix
+    template<typename Visitor>
+    void forEachPrefix(std::string_view prefix, Visitor visit) const {
+        for (Cursor it = cursor(lowerBound(prefix)); it.valid(); it.next()) {
+            if (it.key().compare(0, prefix.size(), prefix) != 0) break;
+            visit(it.key(), it.ordinal());
+        }
+    }
+
+    // Visit (key, ordinal) for every key in [low, high)
+    template<typename Visitor>
+    void forEachInRange(std::string_view low, std::string_view high, Visitor visit) const {
+        for (Cursor it = cursor(lowerBound(low)); it.valid() && it.key() < high; it.next()) {
+            visit(it.key(), it.ordinal());
+        }
+    }
+
+private:
+    std::vector<uint8_t> owned;
+    const uint8_t* data;
+    size_t length;
+    size_t count;
+    size_t blockCount;
+
+    const uint8_t* block(size_t index) const;
+    std::string_view blockHead(size_t index) const;
+
+    // Ordinal of key if present (found set), else of the first key after it
+    size_t search(std::string_view key, bool& found) const;
+};
+
+// The keys of a TermDictionary spelled backwards, in a dictionary of their
+// own, so keys can be found by suffix: the keys ending in "coin" are the
+// reversed keys starting with "nioc".
+//
+// Layout (little-endian):
+//   { dictionaryBytes u32, reversed-key TermDictionary,
+//     forward ordinal u32 of each reversed key, in reversed-key order }
+class SuffixIndex {
+public:
+    SuffixIndex();
+
+    // Take ownership of bytes produced by build()
+    explicit SuffixIndex(std::vector<uint8_t> encoded);
+
+    // Read an index whose bytes are owned elsewhere; false if malformed
+    bool open(const uint8_t* data, size_t size);
+
+    static std::vector<uint8_t> build(const TermDictionary& keys);
+
+    size_t encodedSize() const { return length; }
+
+    const TermDictionary& reversedKeys() const { return reversed; }
+
+    // Forward ordinal of the key at an ordinal of reversedKeys()
+    size_t forwardOrdinal(size_t reversedOrdinal) const;
+
+private:
+    std::vector<uint8_t> owned;
+    TermDictionary reversed;
+    const uint8_t* ordinals;
+    size_t length;
+};
+
+// Encodes keys added in strictly increasing order
+class TermDictionaryBuilder {
+public:
+    TermDictionaryBuilder();
+
+    void add(std::string_view key);
+    size_t size() const { return count; }
+
+    // The encoded dictionary; the builder is left empty
+    std::vector<uint8_t> finish();
+
+private:
+    std::vector<uint8_t> entries;
+    std::vector<uint32_t> blockOffsets;
+    std::string previous;
+    size_t count;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TIEREDMERGEPOLICY_H
+#define TIEREDMERGEPOLICY_H
+
+#include <cstddef>
+#include <vector>
+
+// Decides which segments to merge so their number stays logarithmic in the
+// index size.
+//
+// Segments fall into tiers by document count: tier 0 holds segments of up
+// to minSegmentDocuments documents, and each tier above holds segments up
+// to mergeFactor times larger. Once mergeFactor adjacent segments share a
+// tier they are merged into one segment of the next tier, lowest tier
+// first, so every document is rewritten about once per tier. Only adjacent
+// segments are merged, which keeps each segment's docIds one range, and
+// merges that would exceed maxMergedDocuments are left alone. Sizes count
+// live documents only, and when no tier is full a segment whose deleted
+// documents exceed maxDeletedShare of it is rewritten alone to drop them.
+class TieredMergePolicy {
+public:
+    static constexpr size_t DEFAULT_MERGE_FACTOR = 10;
+    static constexpr size_t DEFAULT_MIN_SEGMENT_DOCUMENTS = 10000;
+    static constexpr size_t DEFAULT_MAX_MERGED_DOCUMENTS = 5000000;
+    static constexpr double DEFAULT_MAX_DELETED_SHARE = 0.2;
+
+    explicit TieredMergePolicy(size_t mergeFactor = DEFAULT_MERGE_FACTOR,
+                               size_t minSegmentDocuments = DEFAULT_MIN_SEGMENT_DOCUMENTS,
+                               size_t maxMergedDocuments = DEFAULT_MAX_MERGED_DOCUMENTS,
+                               double maxDeletedShare = DEFAULT_MAX_DELETED_SHARE);
+
+    // Given the live and the deleted document counts of the segments in
+    // docId order, find the next run of segments to merge: count segments
+    // starting at first. False if none needs merging.
+    bool findMerge(const std::vector<size_t>& liveDocuments, const std::vector<size_t>& deletedDocuments,
+                   size_t& first, size_t& count) const;
+
+    // Tier of a segment with this many documents
+    size_t tier(size_t documents) const;
+
+private:
+    size_t mergeFactor;
+    size_t minSegmentDocuments;
+    size_t maxMergedDocuments;
+    double maxDeletedShare;
+};
+
+#endif
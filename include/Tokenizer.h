@@ -0,0 +1,36 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Single-pass, allocation-free tokenizer.
+//
+// Splits text on ASCII whitespace and punctuation, lowercases ASCII letters
+// and drops every other byte (control characters and non-ASCII bytes), the
+// same way cleanText + istringstream + tolower used to. Work happens in
+// place: kept bytes are compacted towards the start of the buffer and the
+// tokens are views into it.
+//
+// On x86-64 the text is classified 16 (SSE2) or 32 (AVX2) bytes at a time;
+// chunks made only of letters, digits and separators are lowercased and
+// split with bit masks, anything else falls back to the per-byte table.
+// The kernel is picked once at runtime from the CPU's features.
+class Tokenizer {
+public:
+    enum class Kernel { SCALAR, SSE2, AVX2 };
+
+    // Tokenize data[0, length) in place, replacing the contents of tokens.
+    // tokens stay valid as long as the buffer does.
+    static void tokenize(char* data, size_t length, std::vector<std::string_view>& tokens);
+
+    // Same, with an explicit kernel; one the CPU lacks must not be requested
+    static void tokenize(char* data, size_t length, std::vector<std::string_view>& tokens,
+                         Kernel kernel);
+
+    // Best kernel for this CPU
+    static Kernel selectKernel();
+};
+
+#endif
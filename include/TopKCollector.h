@@ -0,0 +1,42 @@
+#ifndef TOPKCOLLECTOR_H
+#define TOPKCOLLECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A scored search hit
+struct ScoredDoc {
+    double score;
+    uint32_t docId;
+};
+
+// Keeps the best `capacity` hits offered to it in a bounded min-heap whose
+// top is the weakest hit kept, so ranking n matches takes O(n log k) time
+// and O(k) memory instead of a full sort. Higher scores rank first and
+// equal scores rank by ascending docId.
+class TopKCollector {
+public:
+    explicit TopKCollector(size_t capacity);
+
+    void offer(double score, uint32_t docId);
+
+    size_t size() const { return heap.size(); }
+    bool full() const { return heap.size() >= capacity; }
+
+    // Score a hit must beat to be kept once the collector is full
+    double threshold() const;
+
+    // Kept hits, best first; leaves the collector empty
+    std::vector<ScoredDoc> takeSorted();
+
+private:
+    std::vector<ScoredDoc> heap;
+    size_t capacity;
+
+    static bool ranksBefore(const ScoredDoc& a, const ScoredDoc& b) {
+        return a.score != b.score ? a.score > b.score : a.docId < b.docId;
+    }
+};
+
+#endif
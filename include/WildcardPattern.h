@@ -0,0 +1,46 @@
+#ifndef WILDCARDPATTERN_H
+#define WILDCARDPATTERN_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TermDictionary.h"
+
+// Glob-style term pattern: '*' matches any run of characters and '?' any
+// single one, so "econom*" or "*coin".
+//
+// Patterns are expanded against a dictionary through their longer literal
+// end: the text before the first wildcard selects a range of the sorted
+// keys, the text after the last one a range of the suffix index. Only keys
+// in that range are checked against the whole pattern, and expansion stops
+// after MAX_EXPANSIONS matching keys or MAX_SCANNED checked ones, so its
+// cost does not grow with the vocabulary.
+class WildcardPattern {
+public:
+    static constexpr size_t MAX_EXPANSIONS = 128;
+    static constexpr size_t MAX_SCANNED = 65536;
+
+    explicit WildcardPattern(std::string_view pattern);
+
+    // Whether a query term contains wildcards
+    static bool isPattern(std::string_view term);
+
+    // Lowercase a query token and drop what the tokenizer would, keeping
+    // the wildcards
+    static std::string normalize(std::string_view token);
+
+    bool matches(std::string_view key) const;
+
+    // Ordinals of matching keys in increasing order; truncated is set if
+    // expansion stopped early, so more keys may match
+    std::vector<size_t> expand(const TermDictionary& keys, const SuffixIndex& suffixes,
+                               bool& truncated) const;
+
+private:
+    std::string pattern;
+    size_t prefixLength;   // literal bytes before the first wildcard
+    size_t suffixLength;   // literal bytes after the last wildcard
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "BlockMaxWand.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Bounds are widened slightly so floating-point rounding in the real score
+// can never push it above its bound
+constexpr double BOUND_SLACK = 1 + 1e-9;
+
+} // namespace
+
+BlockMaxWand::BlockMaxWand(const Bm25& bm25, LengthLookup documentLength)
+    : bm25(bm25), documentLength(std::move(documentLength)) {}
+
+void BlockMaxWand::addTerm(const PostingListView& postings) {
+    addTerm(postings, bm25.idf(static_cast<uint32_t>(postings.documentCount)));
+}
+
+void BlockMaxWand::addTerm(const PostingListView& postings, double idf) {
+    if (postings.empty()) return;
+
+    double maxScore = bm25.score(idf, postings.maxFrequency, postings.minDocumentLength) * BOUND_SLACK;
+    cursors.push_back({postings.iterator(), idf, maxScore});
+}
+
+double BlockMaxWand::blockBound(const TermCursor& cursor) const {
+    return bm25.score(cursor.idf, cursor.it.blockMaxFrequency(),
+                      cursor.it.blockMinDocumentLength()) * BOUND_SLACK;
+}
+
+size_t BlockMaxWand::run(TopKCollector& topK, const Filter& accept) {
+    // Cursors ordered by their current docId
+    std::vector<TermCursor*> order;
+    for (auto& cursor : cursors) {
+        order.push_back(&cursor);
+    }
+
+    size_t scored = 0;
+    while (true) {
+        // Only a few cursors move per round, so insertion sort is cheap
+        order.erase(std::remove_if(order.begin(), order.end(), [](const TermCursor* c) {
+                        return c->it.docId() == PostingIterator::END;
+                    }),
+                    order.end());
+        for (size_t i = 1; i < order.size(); ++i) {
+            for (size_t j = i; j > 0 && order[j]->it.docId() < order[j - 1]->it.docId(); --j) {
+                std::swap(order[j], order[j - 1]);
+            }
+        }
+
+        // Pivot: the first cursor at which the summed term bounds beat the
+        // heap. No document before the pivot's can make it into the heap.
+        double threshold = topK.threshold();
+        double bound = 0.0;
+        size_t pivot = order.size();
+        for (size_t i = 0; i < order.size(); ++i) {
+            bound += order[i]->maxScore;
+            if (bound > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) break;
+
+        uint32_t pivotDoc = order[pivot]->it.docId();
+        while (pivot + 1 < order.size() && order[pivot + 1]->it.docId() == pivotDoc) {
+            pivot++;
+        }
+
+        // Tighter check against the blocks that would hold the pivot
+        double blockSum = 0.0;
+        for (size_t i = 0; i <= pivot; ++i) {
+            order[i]->it.shallowAdvance(pivotDoc);
+            blockSum += blockBound(*order[i]);
+        }
+
+        if (blockSum > threshold) {
+            if (order[0]->it.docId() == pivotDoc) {
+                // Every cursor up to the pivot is on the pivot: score it
+                if (accept(pivotDoc)) {
+                    uint32_t length = documentLength(pivotDoc);
+                    double score = 0.0;
+                    for (size_t i = 0; i <= pivot; ++i) {
+                        score += bm25.score(order[i]->idf, order[i]->it.frequency(), length);
+                    }
+                    topK.offer(score, pivotDoc);
+                    scored++;
+                }
+                for (size_t i = 0; i <= pivot; ++i) {
+                    order[i]->it.next();
+                }
+            } else {
+                // Bring the cursors lagging behind up to the pivot
+                for (size_t i = 0; i < pivot; ++i) {
+                    order[i]->it.advance(pivotDoc);
+                }
+            }
+        } else {
+            // Nothing can make it before one of these blocks ends or another
+            // term starts, so skip the rest of the blocks
+            uint32_t next = PostingIterator::END;
+            for (size_t i = 0; i <= pivot; ++i) {
+                next = std::min(next, order[i]->it.blockLastDocId());
+            }
+            if (next != PostingIterator::END) {
+                next++;
+            }
+            if (pivot + 1 < order.size()) {
+                next = std::min(next, order[pivot + 1]->it.docId());
+            }
+            for (size_t i = 0; i <= pivot; ++i) {
+                order[i]->it.advance(next);
+            }
+        }
+    }
+    return scored;
+}
@@ -0,0 +1,14 @@
+#include "Bm25.h"
+#include <cmath>
+
+Bm25::Bm25(size_t documentCount, double averageDocumentLength)
+    : documentCount(documentCount),
+      lengthBase(K1 * (1 - B)),
+      lengthScale(averageDocumentLength > 0 ? K1 * B / averageDocumentLength : 0) {}
+
+double Bm25::idf(uint32_t documentFrequency) const {
+    // The "+ 1" keeps IDF positive for terms found in most documents
+    double n = static_cast<double>(documentCount);
+    double df = static_cast<double>(documentFrequency);
+    return std::log(1 + (n - df + 0.5) / (df + 0.5));
+}
@@ -0,0 +1,38 @@
+#include "DeletedDocs.h"
+#include <algorithm>
+
+DeletedDocs::DeletedDocs(uint32_t baseDocId, uint32_t endDocId)
+    : base(baseDocId), end(std::max(baseDocId, endDocId)),
+      words((end - base + 63) / 64, 0), count(0) {}
+
+bool DeletedDocs::containsAny(uint32_t first, uint32_t last) const {
+    if (count == 0 || last < base || first >= end) {
+        return false;
+    }
+    uint32_t from = std::max(first, base) - base;
+    uint32_t to = std::min(last, end - 1) - base;
+
+    // Mask the partial words at both ends, test whole words in between
+    uint64_t lowMask = ~uint64_t(0) << (from % 64);
+    uint64_t highMask = ~uint64_t(0) >> (63 - to % 64);
+    if (from / 64 == to / 64) {
+        return (words[from / 64] & lowMask & highMask) != 0;
+    }
+    if ((words[from / 64] & lowMask) != 0 || (words[to / 64] & highMask) != 0) {
+        return true;
+    }
+    for (size_t i = from / 64 + 1; i < to / 64; ++i) {
+        if (words[i] != 0) return true;
+    }
+    return false;
+}
+
+bool DeletedDocs::add(uint32_t docId) {
+    if (docId < base || docId >= end || contains(docId)) {
+        return false;
+    }
+    uint32_t bit = docId - base;
+    words[bit / 64] |= uint64_t(1) << (bit % 64);
+    count++;
+    return true;
+}
@@ -1,11 +1,9 @@
 #include "DocumentParser.h"
+#include "Tokenizer.h"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <cstdio>
-#include <algorithm>
-#include <cctype>
 #include "rapidjson/document.h"
 #include "rapidjson/filereadstream.h"
 
@@ -50,10 +48,13 @@ std::unique_ptr<Document> DocumentParser::parseDocument(const std::string& fileP
     }
 
     if (jsonDoc.HasMember("text") && jsonDoc["text"].IsString()) {
-        std::string originalText = jsonDoc["text"].GetString();
-        doc->setText(originalText);  // Set original text first
-        std::string processedText = processText(originalText);
-        doc->setProcessedText(processedText);  // Then set processed text
+        std::string_view text(jsonDoc["text"].GetString(), jsonDoc["text"].GetStringLength());
+        doc->setText(std::string(text));  // Original text for display
+
+        std::vector<char> buffer;
+        std::vector<std::string_view> terms;
+        processText(text, buffer, terms);
+        doc->setTerms(std::move(buffer), std::move(terms));
     }
 
     // Extract arrays
@@ -72,48 +73,59 @@ std::unique_ptr<Document> DocumentParser::parseDocument(const std::string& fileP
     return doc;
 }
 
-std::vector<std::unique_ptr<Document>> DocumentParser::parseDirectory(const std::string& directoryPath) {
-    std::vector<std::unique_ptr<Document>> documents;
+size_t DocumentParser::parseDirectory(const std::string& directoryPath,
+                                      const std::function<void(std::unique_ptr<Document>)>& sink) {
+    size_t count = 0;
     
+    forEachJsonFile(directoryPath, [&](const std::string& path) {
+        if (auto doc = parseDocument(path)) {
+            sink(std::move(doc));
+            count++;
+        }
+        return true;
+    });
+
+    return count;
+}
+
+void DocumentParser::forEachJsonFile(const std::string& directoryPath,
+                                     const std::function<bool(const std::string&)>& visit) {
     try {
         for (const auto& entry : fs::recursive_directory_iterator(directoryPath)) {
             if (entry.is_regular_file() && entry.path().extension() == ".json") {
-                if (auto doc = parseDocument(entry.path().string())) {
-                    documents.push_back(std::move(doc));
+                if (!visit(entry.path().string())) {
+                    break;
                 }
             }
         }
     } catch (const fs::filesystem_error& e) {
         // Ignore filesystem errors
     }
-
-    return documents;
 }
 
-std::string DocumentParser::processText(const std::string& text) {
-    std::string cleaned = cleanText(text);
-    std::istringstream iss(cleaned);
-    std::ostringstream oss;
-    std::string word;
+void DocumentParser::processText(std::string_view text, std::vector<char>& buffer,
+                                 std::vector<std::string_view>& terms) {
+    buffer.assign(text.begin(), text.end());
+    Tokenizer::tokenize(buffer.data(), buffer.size(), terms);
 
-    while (iss >> word) {
-        // Convert to lowercase
-        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-        
+    // Filter and stem in place; a stem is never longer than its word, so
+    // it can be written back over the token
+    size_t kept = 0;
+    for (std::string_view word : terms) {
         // Skip if it's a stopword
         if (stopWords.isStopWord(word)) {
             continue;
         }
 
-        // Apply stemming
-        std::string stemmed = stemmer.stemWord(word);
-        word = stemmed;
-        
-        oss << word << " ";
+        // Apply stemming; a word can stem to nothing (e.g. "ment")
+        char* start = const_cast<char*>(word.data());
+        size_t length = stemmer.stem(start, word.size());
+        if (length == 0) {
+            continue;
+        }
+        terms[kept++] = std::string_view(start, length);
     }
-
-    std::string result = oss.str();
-    return result;
+    terms.resize(kept);
 }
 
 std::vector<std::string> DocumentParser::extractJsonArray(const rapidjson::Value& array) {
@@ -125,21 +137,3 @@ std::vector<std::string> DocumentParser::extractJsonArray(const rapidjson::Value
     }
     return result;
 }
-
-std::string DocumentParser::cleanText(const std::string& text) {
-    std::string cleaned;
-    cleaned.reserve(text.length());
-    
-    for (char c : text) {
-        // Replace punctuation with spaces
-        if (std::ispunct(c)) {
-            cleaned += ' ';
-        }
-        // Keep alphanumeric characters and spaces
-        else if (std::isalnum(c) || std::isspace(c)) {
-            cleaned += c;
-        }
-    }
-    
-    return cleaned;
-} 
\ No newline at end of file
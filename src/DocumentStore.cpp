@@ -0,0 +1,437 @@
+#include "DocumentStore.h"
+#include <fstream>
+#include <stdexcept>
+#include <zlib.h>
+#include "BinaryIO.h"
+
+namespace {
+
+void appendList(std::vector<uint8_t>& out, const std::vector<std::string>& items) {
+    BinaryIO::append<uint32_t>(out, static_cast<uint32_t>(items.size()));
+    for (const auto& item : items) {
+        BinaryIO::appendString(out, item);
+    }
+}
+
+// Length-prefixed string ending at or before end; nullptr if it doesn't
+const uint8_t* readString(const uint8_t* in, const uint8_t* end, std::string_view& str) {
+    if (end - in < 4 || static_cast<uint64_t>(end - in - 4) < BinaryIO::load<uint32_t>(in)) {
+        return nullptr;
+    }
+    return BinaryIO::readString(in, str);
+}
+
+// Body fields are read from decompressed blocks, so a bad length throws
+const uint8_t* readBodyString(const uint8_t* in, const uint8_t* end, std::string_view& str) {
+    in = readString(in, end, str);
+    if (!in) {
+        throw std::runtime_error("Corrupt document block");
+    }
+    return in;
+}
+
+const uint8_t* readList(const uint8_t* in, const uint8_t* end, std::vector<std::string>& items) {
+    if (end - in < 4) {
+        throw std::runtime_error("Corrupt document block");
+    }
+    uint32_t size = BinaryIO::load<uint32_t>(in);
+    in += 4;
+    items.clear();
+    for (uint32_t i = 0; i < size; ++i) {
+        std::string_view item;
+        in = readBodyString(in, end, item);
+        items.emplace_back(item);
+    }
+    return in;
+}
+
+std::string compressBlock(const std::vector<uint8_t>& block) {
+    uLongf compressedSize = compressBound(block.size());
+    std::string compressed(4 + compressedSize, '\0');
+    BinaryIO::store<uint32_t>(reinterpret_cast<uint8_t*>(&compressed[0]), static_cast<uint32_t>(block.size()));
+    if (compress2(reinterpret_cast<Bytef*>(&compressed[4]), &compressedSize,
+                  block.data(), block.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("Failed to compress document block");
+    }
+    compressed.resize(4 + compressedSize);
+    return compressed;
+}
+
+std::vector<uint8_t> decompressBlock(std::string_view compressed) {
+    if (compressed.size() < 4) {
+        throw std::runtime_error("Corrupt document block");
+    }
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(compressed.data());
+    uLongf size = BinaryIO::load<uint32_t>(in);
+    std::vector<uint8_t> block(size);
+    if (uncompress(block.data(), &size, in + 4, compressed.size() - 4) != Z_OK ||
+        size != block.size()) {
+        throw std::runtime_error("Corrupt document block");
+    }
+    return block;
+}
+
+} // namespace
+
+DocumentStore::DocumentStore() : spillFile(nullptr), spillOffsets(1, 0), mappedDocuments(0), mappedBlocks(0) {}
+
+DocumentStore::~DocumentStore() {
+    if (spillFile) {
+        std::fclose(spillFile);
+    }
+}
+
+uint32_t DocumentStore::add(const Document& doc) {
+    if (file.isOpen()) {
+        detach();
+    }
+
+    uint32_t docId = static_cast<uint32_t>(metadata.size());
+    metadata.push_back({doc.getFilePath(), doc.getTitle(), doc.getPublication(),
+                        doc.getDatePublished(), static_cast<uint32_t>(blockCount()),
+                        static_cast<uint32_t>(openOffsets.size())});
+
+    openOffsets.push_back(static_cast<uint32_t>(openRecords.size()));
+    BinaryIO::appendString(openRecords, doc.getText());
+    appendList(openRecords, doc.getAuthors());
+    appendList(openRecords, doc.getOrganizations());
+    appendList(openRecords, doc.getPersons());
+
+    if (openRecords.size() >= BLOCK_BYTES) {
+        flush();
+    }
+    return docId;
+}
+
+DocumentStore::Block DocumentStore::buildOpenBlock() const {
+    Block block;
+    block.reserve(4 + (openOffsets.size() + 1) * 4 + openRecords.size());
+    BinaryIO::append<uint32_t>(block, static_cast<uint32_t>(openOffsets.size()));
+    for (uint32_t offset : openOffsets) {
+        BinaryIO::append<uint32_t>(block, offset);
+    }
+    BinaryIO::append<uint32_t>(block, static_cast<uint32_t>(openRecords.size()));
+    block.insert(block.end(), openRecords.begin(), openRecords.end());
+    return block;
+}
+
+void DocumentStore::appendBlock(const std::string& compressed) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!spillFile) {
+        spillFile = std::tmpfile();
+        if (!spillFile) {
+            throw std::runtime_error("Cannot create document store spill file");
+        }
+    }
+
+    std::fseek(spillFile, static_cast<long>(spillOffsets.back()), SEEK_SET);
+    if (std::fwrite(compressed.data(), 1, compressed.size(), spillFile) != compressed.size()) {
+        throw std::runtime_error("Failed writing document store spill file");
+    }
+    spillOffsets.push_back(spillOffsets.back() + compressed.size());
+}
+
+void DocumentStore::flush() {
+    if (openOffsets.empty()) return;
+
+    appendBlock(compressBlock(buildOpenBlock()));
+    openRecords.clear();
+    openOffsets.clear();
+}
+
+bool DocumentStore::write(const std::string& filePath) {
+    // A mapped store is written straight from the mapping
+    flush();
+
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    size_t documents = size();
+    BinaryIO::write<uint32_t>(out, MAGIC);
+    BinaryIO::write<uint32_t>(out, VERSION);
+    BinaryIO::write<uint32_t>(out, static_cast<uint32_t>(documents));
+    size_t blocks = blockCount();
+    BinaryIO::write<uint32_t>(out, static_cast<uint32_t>(blocks));
+
+    // Reserve both offset tables, stream the sections, then fill the tables in
+    std::vector<uint64_t> offsets(documents + 1 + blocks + 1);
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    uint64_t offset = HEADER_SIZE + offsets.size() * sizeof(uint64_t);
+
+    std::vector<uint8_t> record;
+    for (size_t i = 0; i < documents; ++i) {
+        Metadata entry = metadataAt(static_cast<uint32_t>(i));
+        record.clear();
+        BinaryIO::appendString(record, entry.filePath);
+        BinaryIO::appendString(record, entry.title);
+        BinaryIO::appendString(record, entry.publication);
+        BinaryIO::appendString(record, entry.datePublished);
+        BinaryIO::append<uint32_t>(record, entry.block);
+        BinaryIO::append<uint32_t>(record, entry.slot);
+
+        offsets[i] = offset;
+        out.write(reinterpret_cast<const char*>(record.data()), record.size());
+        offset += record.size();
+    }
+    offsets[documents] = offset;
+
+    uint64_t* blockOffsets = offsets.data() + documents + 1;
+    for (size_t i = 0; i < blocks; ++i) {
+        std::string compressed;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            compressed = compressedBlock(static_cast<uint32_t>(i));
+        }
+        blockOffsets[i] = offset;
+        out.write(compressed.data(), compressed.size());
+        offset += compressed.size();
+    }
+    blockOffsets[blocks] = offset;
+
+    out.seekp(HEADER_SIZE);
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    out.close();
+    return !out.fail();
+}
+
+bool DocumentStore::open(const std::string& filePath) {
+    clear();
+    if (!file.open(filePath)) {
+        return false;
+    }
+
+    const uint8_t* base = file.data();
+    if (file.size() < HEADER_SIZE ||
+        BinaryIO::load<uint32_t>(base) != MAGIC ||
+        BinaryIO::load<uint32_t>(base + 4) != VERSION) {
+        clear();
+        return false;
+    }
+
+    mappedDocuments = BinaryIO::load<uint32_t>(base + 8);
+    mappedBlocks = BinaryIO::load<uint32_t>(base + 12);
+    uint64_t tableBytes = (static_cast<uint64_t>(mappedDocuments) + mappedBlocks + 2) * sizeof(uint64_t);
+    if (HEADER_SIZE + tableBytes > file.size()) {
+        clear();
+        return false;
+    }
+
+    // metadataAt and compressedBlock trust the offset tables, so check them
+    // once here. The two tables run on from each other: every offset is at
+    // least the one before it, and all of them lie inside the file.
+    const uint8_t* offsets = base + HEADER_SIZE;
+    size_t offsetCount = static_cast<size_t>(mappedDocuments) + mappedBlocks + 2;
+    uint64_t previous = HEADER_SIZE + tableBytes;
+    for (size_t i = 0; i < offsetCount; ++i) {
+        uint64_t offset = BinaryIO::load<uint64_t>(offsets + i * sizeof(uint64_t));
+        if (offset < previous || offset > file.size()) {
+            clear();
+            return false;
+        }
+        previous = offset;
+    }
+
+    // Each metadata record fits before the next and names a stored block,
+    // and each block holds at least its uncompressed size
+    for (uint32_t docId = 0; docId < mappedDocuments; ++docId) {
+        const uint8_t* in = base + BinaryIO::load<uint64_t>(offsets + docId * sizeof(uint64_t));
+        const uint8_t* end = base + BinaryIO::load<uint64_t>(offsets + (docId + 1) * sizeof(uint64_t));
+        std::string_view field;
+        for (int i = 0; i < 4 && in; ++i) {
+            in = readString(in, end, field);
+        }
+        if (!in || end - in < 8 || BinaryIO::load<uint32_t>(in) >= mappedBlocks) {
+            clear();
+            return false;
+        }
+    }
+    const uint8_t* blockOffsets = offsets + (mappedDocuments + 1) * sizeof(uint64_t);
+    for (uint32_t block = 0; block < mappedBlocks; ++block) {
+        if (BinaryIO::load<uint64_t>(blockOffsets + (block + 1) * sizeof(uint64_t)) -
+            BinaryIO::load<uint64_t>(blockOffsets + block * sizeof(uint64_t)) < 4) {
+            clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void DocumentStore::clear() {
+    file.close();
+    mappedDocuments = 0;
+    mappedBlocks = 0;
+    metadata.clear();
+    openRecords.clear();
+    openOffsets.clear();
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.clear();
+    if (spillFile) {
+        std::fclose(spillFile);
+        spillFile = nullptr;
+    }
+    spillOffsets.assign(1, 0);
+}
+
+size_t DocumentStore::size() const {
+    return file.isOpen() ? mappedDocuments : metadata.size();
+}
+
+size_t DocumentStore::blockCount() const {
+    return file.isOpen() ? mappedBlocks : spillOffsets.size() - 1;
+}
+
+DocumentStore::Metadata DocumentStore::metadataAt(uint32_t docId) const {
+    if (!file.isOpen()) {
+        return metadata[docId];
+    }
+
+    const uint8_t* offsets = file.data() + HEADER_SIZE;
+    const uint8_t* in = file.data() + BinaryIO::load<uint64_t>(offsets + docId * sizeof(uint64_t));
+
+    std::string_view path, title, publication, date;
+    in = BinaryIO::readString(in, path);
+    in = BinaryIO::readString(in, title);
+    in = BinaryIO::readString(in, publication);
+    in = BinaryIO::readString(in, date);
+    return {std::string(path), std::string(title), std::string(publication), std::string(date),
+            BinaryIO::load<uint32_t>(in), BinaryIO::load<uint32_t>(in + 4)};
+}
+
+// Spilled blocks share the spill file's position, so callers hold cacheMutex
+std::string DocumentStore::compressedBlock(uint32_t block) const {
+    if (file.isOpen()) {
+        const uint8_t* offsets = file.data() + HEADER_SIZE + (mappedDocuments + 1) * sizeof(uint64_t);
+        uint64_t begin = BinaryIO::load<uint64_t>(offsets + block * sizeof(uint64_t));
+        uint64_t end = BinaryIO::load<uint64_t>(offsets + (block + 1) * sizeof(uint64_t));
+        return std::string(reinterpret_cast<const char*>(file.data() + begin), end - begin);
+    }
+
+    std::string compressed(spillOffsets[block + 1] - spillOffsets[block], '\0');
+    std::fseek(spillFile, static_cast<long>(spillOffsets[block]), SEEK_SET);
+    if (std::fread(&compressed[0], 1, compressed.size(), spillFile) != compressed.size()) {
+        throw std::runtime_error("Failed reading document store spill file");
+    }
+    return compressed;
+}
+
+std::shared_ptr<const DocumentStore::Block> DocumentStore::getBlock(uint32_t block) const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->first == block) {
+            cache.splice(cache.begin(), cache, it);
+            return it->second;
+        }
+    }
+
+    // Past the last compressed block is the one still being filled, which
+    // keeps changing and so is never cached
+    if (block >= blockCount()) {
+        return std::make_shared<const Block>(buildOpenBlock());
+    }
+
+    auto loaded = std::make_shared<const Block>(decompressBlock(compressedBlock(block)));
+    cache.emplace_front(block, loaded);
+    if (cache.size() > CACHE_BLOCKS) {
+        cache.pop_back();
+    }
+    return loaded;
+}
+
+std::shared_ptr<Document> DocumentStore::loadSummary(uint32_t docId) const {
+    if (docId >= size()) {
+        return nullptr;
+    }
+
+    Metadata entry = metadataAt(docId);
+    auto doc = std::make_shared<Document>(entry.filePath);
+    doc->setTitle(entry.title);
+    doc->setPublication(entry.publication);
+    doc->setDatePublished(entry.datePublished);
+    doc->setDocId(docId);
+    return doc;
+}
+
+std::shared_ptr<Document> DocumentStore::load(uint32_t docId) const {
+    if (docId >= size()) {
+        return nullptr;
+    }
+
+    Metadata entry = metadataAt(docId);
+    auto doc = std::make_shared<Document>(entry.filePath);
+    doc->setTitle(entry.title);
+    doc->setPublication(entry.publication);
+    doc->setDatePublished(entry.datePublished);
+    doc->setDocId(docId);
+
+    // The block's record count, offsets and record lengths come from the
+    // file, so check each against the decompressed size
+    auto block = getBlock(entry.block);
+    const uint8_t* base = block->data();
+    const uint8_t* end = base + block->size();
+    uint64_t count = block->size() >= 4 ? BinaryIO::load<uint32_t>(base) : 0;
+    if (entry.slot >= count || 4 + (count + 1) * 4 > block->size()) {
+        throw std::runtime_error("Corrupt document block");
+    }
+    uint32_t offset = BinaryIO::load<uint32_t>(base + 4 + entry.slot * 4);
+    const uint8_t* records = base + 4 + (count + 1) * 4;
+    if (offset > static_cast<size_t>(end - records)) {
+        throw std::runtime_error("Corrupt document block");
+    }
+    const uint8_t* in = records + offset;
+
+    std::string_view text;
+    in = readBodyString(in, end, text);
+    doc->setText(std::string(text));
+
+    std::vector<std::string> items;
+    in = readList(in, end, items);
+    doc->setAuthors(items);
+    in = readList(in, end, items);
+    doc->setOrganizations(items);
+    readList(in, end, items);
+    doc->setPersons(items);
+    return doc;
+}
+
+std::unique_ptr<DocumentStore> DocumentStore::copy() const {
+    auto copied = std::make_unique<DocumentStore>();
+    if (file.isOpen()) {
+        copyMapped(*copied);
+        return copied;
+    }
+
+    // Not mapped: the same documents, re-added
+    for (uint32_t docId = 0; docId < metadata.size(); ++docId) {
+        copied->add(*load(docId));
+    }
+    return copied;
+}
+
+void DocumentStore::copyMapped(DocumentStore& target) const {
+    target.metadata.reserve(mappedDocuments);
+    for (uint32_t docId = 0; docId < mappedDocuments; ++docId) {
+        target.metadata.push_back(metadataAt(docId));
+    }
+
+    // Block numbers stay the same in the (empty) spill file
+    for (uint32_t block = 0; block < mappedBlocks; ++block) {
+        target.appendBlock(compressedBlock(block));
+    }
+}
+
+void DocumentStore::detach() {
+    // Copy while the mapping is still readable, then take over the copy
+    DocumentStore copied;
+    copyMapped(copied);
+
+    file.close();
+    mappedDocuments = 0;
+    mappedBlocks = 0;
+    metadata = std::move(copied.metadata);
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    std::swap(spillFile, copied.spillFile);
+    spillOffsets = std::move(copied.spillOffsets);
+}
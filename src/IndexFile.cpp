@@ -0,0 +1,234 @@
+#include "IndexFile.h"
+#include "BinaryIO.h"
+#include <utility>
+
+using BinaryIO::load;
+
+IndexFile::IndexFile()
+    : documents(0), lengths(nullptr), totalLength(0), removed(nullptr), removedDocuments(0), fields() {}
+
+bool IndexFile::open(const std::string& filePath) {
+    close();
+    if (!file.open(filePath)) {
+        return false;
+    }
+
+    const uint8_t* base = file.data();
+    if (file.size() < HEADER_SIZE ||
+        load<uint32_t>(base) != MAGIC ||
+        load<uint32_t>(base + 4) != VERSION ||
+        load<uint32_t>(base + 12) != INDEX_FIELD_COUNT) {
+        close();
+        return false;
+    }
+
+    documents = load<uint32_t>(base + 8);
+    uint64_t lengthsOffset = load<uint64_t>(base + 16);
+    if (lengthsOffset + static_cast<uint64_t>(documents) * 4 > file.size()) {
+        close();
+        return false;
+    }
+    lengths = base + lengthsOffset;
+    totalLength = load<uint64_t>(base + 24);
+
+    uint64_t removedOffset = load<uint64_t>(base + 32);
+    removedDocuments = load<uint32_t>(base + 40);
+    if (removedDocuments > 0) {
+        if (removedOffset + (static_cast<uint64_t>(documents) + 63) / 64 * 8 > file.size()) {
+            close();
+            return false;
+        }
+        removed = base + removedOffset;
+    }
+
+    for (size_t i = 0; i < INDEX_FIELD_COUNT; ++i) {
+        const uint8_t* section = base + FILE_HEADER_SIZE + i * FIELD_HEADER_SIZE;
+        uint64_t entriesOffset = load<uint64_t>(section);
+        uint64_t dictionaryOffset = load<uint64_t>(section + 8);
+        uint64_t suffixesOffset = load<uint64_t>(section + 16);
+        uint32_t dictionaryBytes = load<uint32_t>(section + 24);
+        uint32_t suffixesBytes = load<uint32_t>(section + 28);
+        FieldSection& field = fields[i];
+        if (dictionaryOffset + dictionaryBytes > file.size() ||
+            suffixesOffset + suffixesBytes > file.size() ||
+            !field.keys.open(base + dictionaryOffset, dictionaryBytes) ||
+            !field.suffixes.open(base + suffixesOffset, suffixesBytes) ||
+            field.suffixes.reversedKeys().size() != field.keys.size() ||
+            entriesOffset + static_cast<uint64_t>(field.keys.size()) * ENTRY_SIZE > file.size()) {
+            close();
+            return false;
+        }
+        field.entries = base + entriesOffset;
+        field.flags = load<uint32_t>(section + 32);
+
+        // postingsAt trusts the entries, so check every one once here
+        for (size_t ordinal = 0; ordinal < field.keys.size(); ++ordinal) {
+            const uint8_t* entry = field.entries + ordinal * ENTRY_SIZE;
+            uint64_t postingsOffset = load<uint64_t>(entry);
+            uint64_t postingsBytes = load<uint32_t>(entry + 8);
+            uint32_t documentCount = load<uint32_t>(entry + 12);
+            uint64_t positionsBytes = load<uint32_t>(entry + 24);
+            uint64_t checkpointBytes = 4 * ((static_cast<uint64_t>(documentCount) +
+                                             PostingList::POSITION_INTERVAL - 1) /
+                                            PostingList::POSITION_INTERVAL);
+            if (postingsOffset > file.size() ||
+                postingsBytes + positionsBytes > file.size() - postingsOffset ||
+                (positionsBytes > 0 && positionsBytes < checkpointBytes)) {
+                close();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void IndexFile::close() {
+    file.close();
+    documents = 0;
+    lengths = nullptr;
+    totalLength = 0;
+    removed = nullptr;
+    removedDocuments = 0;
+    for (auto& field : fields) {
+        field = FieldSection();
+    }
+}
+
+bool IndexFile::hasPositions(IndexField field) const {
+    return (fields[static_cast<size_t>(field)].flags & FLAG_POSITIONS) != 0;
+}
+
+const TermDictionary& IndexFile::dictionary(IndexField field) const {
+    return fields[static_cast<size_t>(field)].keys;
+}
+
+const SuffixIndex& IndexFile::suffixes(IndexField field) const {
+    return fields[static_cast<size_t>(field)].suffixes;
+}
+
+PostingListView IndexFile::postingsAt(IndexField field, size_t ordinal) const {
+    const uint8_t* entry = fields[static_cast<size_t>(field)].entries + ordinal * ENTRY_SIZE;
+    PostingListView view;
+    view.data = file.data() + load<uint64_t>(entry);
+    view.size = load<uint32_t>(entry + 8);
+    view.documentCount = load<uint32_t>(entry + 12);
+    view.maxFrequency = load<uint32_t>(entry + 16);
+    view.minDocumentLength = load<uint32_t>(entry + 20);
+
+    uint32_t positionsBytes = load<uint32_t>(entry + 24);
+    if (positionsBytes > 0) {
+        size_t checkpointBytes = 4 * ((view.documentCount + PostingList::POSITION_INTERVAL - 1) /
+                                      PostingList::POSITION_INTERVAL);
+        view.positionCheckpoints = view.data + view.size;
+        view.positionData = view.positionCheckpoints + checkpointBytes;
+        view.positionSize = positionsBytes - checkpointBytes;
+    }
+    return view;
+}
+
+PostingListView IndexFile::find(IndexField field, std::string_view key) const {
+    size_t ordinal = dictionary(field).find(key);
+    return ordinal == TermDictionary::NOT_FOUND ? PostingListView() : postingsAt(field, ordinal);
+}
+
+IndexFileWriter::IndexFileWriter() : offset(0) {}
+
+bool IndexFileWriter::open(const std::string& filePath) {
+    out.open(filePath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    // Placeholder header, patched by finish()
+    std::string header(IndexFile::HEADER_SIZE, '\0');
+    out.write(header.data(), header.size());
+    offset = header.size();
+    return true;
+}
+
+void IndexFileWriter::addKey(IndexField field, std::string_view key, const PostingListView& postings) {
+    FieldBuffer& buffer = fields[static_cast<size_t>(field)];
+    BinaryIO::append<uint64_t>(buffer.entries, offset);
+    BinaryIO::append<uint32_t>(buffer.entries, static_cast<uint32_t>(postings.size));
+    BinaryIO::append<uint32_t>(buffer.entries, static_cast<uint32_t>(postings.documentCount));
+    BinaryIO::append<uint32_t>(buffer.entries, postings.maxFrequency);
+    BinaryIO::append<uint32_t>(buffer.entries, postings.minDocumentLength);
+
+    size_t positionsBytes = 0;
+    if (postings.hasPositions()) {
+        positionsBytes = 4 * ((postings.documentCount + PostingList::POSITION_INTERVAL - 1) /
+                              PostingList::POSITION_INTERVAL) + postings.positionSize;
+        buffer.flags |= IndexFile::FLAG_POSITIONS;
+    }
+    BinaryIO::append<uint32_t>(buffer.entries, static_cast<uint32_t>(positionsBytes));
+    buffer.keys.add(key);
+
+    out.write(reinterpret_cast<const char*>(postings.data), postings.size);
+    offset += postings.size;
+    if (positionsBytes > 0) {
+        out.write(reinterpret_cast<const char*>(postings.positionCheckpoints), positionsBytes - postings.positionSize);
+        out.write(reinterpret_cast<const char*>(postings.positionData), postings.positionSize);
+        offset += positionsBytes;
+    }
+}
+
+bool IndexFileWriter::finish(const std::vector<uint32_t>& documentLengths, const DeletedDocs& removed) {
+    uint64_t lengthsOffset = offset;
+    uint64_t totalLength = 0;
+    std::vector<uint8_t> lengths;
+    lengths.reserve(documentLengths.size() * 4);
+    for (uint32_t length : documentLengths) {
+        BinaryIO::append<uint32_t>(lengths, length);
+        totalLength += length;
+    }
+    out.write(reinterpret_cast<const char*>(lengths.data()), lengths.size());
+    offset += lengths.size();
+
+    uint64_t removedOffset = 0;
+    if (!removed.empty()) {
+        std::vector<uint8_t> bitmap;
+        for (uint64_t word : removed.bitmap()) {
+            BinaryIO::append<uint64_t>(bitmap, word);
+        }
+        removedOffset = offset;
+        out.write(reinterpret_cast<const char*>(bitmap.data()), bitmap.size());
+        offset += bitmap.size();
+    }
+
+    std::vector<uint8_t> header;
+    BinaryIO::append<uint32_t>(header, IndexFile::MAGIC);
+    BinaryIO::append<uint32_t>(header, IndexFile::VERSION);
+    BinaryIO::append<uint32_t>(header, static_cast<uint32_t>(documentLengths.size()));
+    BinaryIO::append<uint32_t>(header, static_cast<uint32_t>(INDEX_FIELD_COUNT));
+    BinaryIO::append<uint64_t>(header, lengthsOffset);
+    BinaryIO::append<uint64_t>(header, totalLength);
+    BinaryIO::append<uint64_t>(header, removedOffset);
+    BinaryIO::append<uint32_t>(header, static_cast<uint32_t>(removed.size()));
+    BinaryIO::append<uint32_t>(header, 0);
+
+    for (auto& buffer : fields) {
+        std::vector<uint8_t> dictionary = buffer.keys.finish();
+        uint64_t entriesOffset = offset;
+        uint64_t dictionaryOffset = offset + buffer.entries.size();
+        uint64_t suffixesOffset = dictionaryOffset + dictionary.size();
+        out.write(reinterpret_cast<const char*>(buffer.entries.data()), buffer.entries.size());
+        out.write(reinterpret_cast<const char*>(dictionary.data()), dictionary.size());
+
+        size_t dictionaryBytes = dictionary.size();
+        std::vector<uint8_t> suffixes = SuffixIndex::build(TermDictionary(std::move(dictionary)));
+        out.write(reinterpret_cast<const char*>(suffixes.data()), suffixes.size());
+        offset = suffixesOffset + suffixes.size();
+
+        BinaryIO::append<uint64_t>(header, entriesOffset);
+        BinaryIO::append<uint64_t>(header, dictionaryOffset);
+        BinaryIO::append<uint64_t>(header, suffixesOffset);
+        BinaryIO::append<uint32_t>(header, static_cast<uint32_t>(dictionaryBytes));
+        BinaryIO::append<uint32_t>(header, static_cast<uint32_t>(suffixes.size()));
+        BinaryIO::append<uint32_t>(header, buffer.flags);
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    out.close();
+    return !out.fail();
+}
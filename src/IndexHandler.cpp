@@ -1,81 +1,476 @@
 #include "IndexHandler.h"
+#include "BlockMaxWand.h"
+#include "LevenshteinAutomaton.h"
+#include "WildcardPattern.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
-#include <sstream>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
 
-IndexHandler::IndexHandler() {}
+namespace {
 
-void IndexHandler::addDocument(const std::unique_ptr<Document>& doc) {
+// Number of ranked hits needed to fill the page at offset
+size_t pageEnd(size_t limit, size_t offset) {
+    return limit > std::numeric_limits<size_t>::max() - offset
+               ? std::numeric_limits<size_t>::max()
+               : offset + limit;
+}
+
+} // namespace
+
+IndexHandler::IndexHandler()
+    : snapshot(std::make_shared<const Snapshot>()), documentStore(std::make_shared<DocumentStore>()) {}
+
+IndexHandler::~IndexHandler() {
+    {
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        stopMerging = true;
+        mergeWake.notify_all();
+        mergeIdle.notify_all();
+    }
+    if (merger.joinable()) {
+        merger.join();
+    }
+}
+
+void IndexHandler::setStorePositions(bool store) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    storePositions = store;
+    if (builder.empty()) {
+        builder.reset(builder.baseDocId(), storePositions);
+    }
+}
+
+void IndexHandler::setStopWords(StopWords words) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto next = std::make_shared<Snapshot>(*currentSnapshot());
+    next->stopWords = std::move(words);
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+}
+
+StopWords IndexHandler::stopWords() const {
+    return currentSnapshot()->stopWords;
+}
+
+void IndexHandler::setSegmentSize(size_t documents) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    segmentSize = documents;
+}
+
+void IndexHandler::addDocument(std::unique_ptr<Document> doc) {
     if (!doc) return;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    indexDocument(std::move(doc));
+}
 
-    // Create shared_ptr and store it
-    auto sharedDoc = std::make_shared<Document>(*doc);
-    documentStore[doc->getFilePath()] = sharedDoc;
+bool IndexHandler::removeDocument(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return deleteDocument(filePath);
+}
+
+bool IndexHandler::updateDocument(std::unique_ptr<Document> doc) {
+    if (!doc) return false;
+    std::lock_guard<std::mutex> lock(writeMutex);
 
-    // Show which file is being indexed
-    std::cout << "Indexing: " << doc->getFilePath() << std::endl;
+    // The deletion waits in pendingDeletions until the new version's
+    // segment is published with it
+    bool replaced = deleteDocument(doc->getFilePath());
+    indexDocument(std::move(doc));
+    return replaced;
+}
 
-    // Index the terms in the document text - use processed text for indexing
-    std::istringstream iss(doc->getProcessedText());
-    std::string term;
-    while (iss >> term) {
-        addToIndex(term, sharedDoc, termIndex);
+void IndexHandler::indexDocument(std::unique_ptr<Document> doc) {
+    // Assign the next dense docId and store the document under it
+    uint32_t docId;
+    {
+        std::lock_guard<std::mutex> storeLock(storeMutex);
+        if (documentStore->isMapped()) {
+            documentStore = documentStore->copy();
+        }
+        docId = documentStore->add(*doc);
     }
+    documentIds[doc->getFilePath()] = docId;
 
-    // Index organizations
-    for (const auto& org : doc->getOrganizations()) {
-        addToIndex(org, sharedDoc, orgIndex);
+    builder.add(docId, *doc);
+    if (segmentSize > 0 && builder.documentCount() >= segmentSize) {
+        publishSegment();
     }
+}
 
-    // Index persons
-    for (const auto& person : doc->getPersons()) {
-        addToIndex(person, sharedDoc, personIndex);
+void IndexHandler::finalizeIndex() {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    publishSegment();
+    std::lock_guard<std::mutex> storeLock(storeMutex);
+    documentStore->flush();
+}
+
+bool IndexHandler::deleteDocument(const std::string& filePath) {
+    completeDocumentIds();
+    auto it = documentIds.find(filePath);
+    if (it == documentIds.end()) {
+        return false;
     }
+    pendingDeletions.push_back(it->second);
+    documentIds.erase(it);
+    return true;
 }
 
-void IndexHandler::addToIndex(const std::string& key, 
-                            const std::shared_ptr<Document>& doc,
-                            AVLTree<std::string, std::vector<std::shared_ptr<Document>>>& index) {
-    std::vector<std::shared_ptr<Document>> docs;
-    try {
-        docs = index.find(key);
-    } catch (...) {
-        // Key doesn't exist yet, start with empty vector
+void IndexHandler::completeDocumentIds() {
+    if (documentIdsComplete) return;
+
+    // Documents added since the load are mapped already; where a path was
+    // indexed more than once its highest docId is the live one
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    for (size_t s = 0; s < current->segments.size(); ++s) {
+        const Segment& segment = *current->segments[s];
+        const DeletedDocs* deleted = current->deletions[s].get();
+        for (uint32_t docId = segment.baseDocId(); docId < segment.endDocId(); ++docId) {
+            if (deleted && deleted->contains(docId)) continue;
+            if (auto doc = segment.loadSummary(docId)) {
+                auto entry = documentIds.emplace(doc->getFilePath(), docId);
+                if (!entry.second && entry.first->second < docId) {
+                    entry.first->second = docId;
+                }
+            }
+        }
     }
-    docs.push_back(doc);
-    index.insert(key, docs);
+    documentIdsComplete = true;
 }
 
-void IndexHandler::saveIndices(const std::string& filePath) {
-    try {
-        termIndex.saveToFile(filePath + "_terms.idx");
-        orgIndex.saveToFile(filePath + "_orgs.idx");
-        personIndex.saveToFile(filePath + "_persons.idx");
-    } catch (const std::exception& e) {
-        // Ignore errors during saving
+void IndexHandler::publishSegment() {
+    if (builder.empty() && pendingDeletions.empty()) return;
+
+    // Copy the segment list and swap the copy in; queries still running
+    // keep the snapshot they started with
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    auto next = std::make_shared<Snapshot>(*current);
+    if (!builder.empty()) {
+        std::shared_ptr<const Segment> segment = builder.build();
+        next->segments.push_back(segment);
+        next->deletions.push_back(nullptr);
+        next->documentCount += segment->liveDocumentCount();
+        next->totalDocumentLength += segment->totalDocumentLength();
+        next->positions = (current->segments.empty() || current->positions) && segment->hasPositions();
+    }
+    applyDeletions(*next);
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+
+    std::lock_guard<std::mutex> mergeLock(mergeMutex);
+    if (!merger.joinable()) {
+        merger = std::thread(&IndexHandler::mergeLoop, this);
     }
+    mergeRequested = true;
+    mergeWake.notify_one();
 }
 
-void IndexHandler::loadIndices(const std::string& filePath) {
-    try {
-        termIndex.loadFromFile(filePath + "_terms.idx");
-        orgIndex.loadFromFile(filePath + "_orgs.idx");
-        personIndex.loadFromFile(filePath + "_persons.idx");
-    } catch (const std::exception& e) {
-        // Ignore errors during loading
+void IndexHandler::applyDeletions(Snapshot& next) {
+    // Each changed bitset is copied once, however many of its docIds go
+    std::vector<std::shared_ptr<DeletedDocs>> copies(next.segments.size());
+    for (uint32_t docId : pendingDeletions) {
+        size_t s = next.segmentIndex(docId);
+        if (s == next.segments.size() || next.segments[s]->isRemoved(docId)) continue;
+        const Segment& segment = *next.segments[s];
+        if (!copies[s]) {
+            copies[s] = next.deletions[s] ? std::make_shared<DeletedDocs>(*next.deletions[s])
+                                          : std::make_shared<DeletedDocs>(segment.baseDocId(), segment.endDocId());
+        }
+        if (copies[s]->add(docId)) {
+            next.documentCount--;
+            next.totalDocumentLength -= segment.documentLength(docId);
+        }
+    }
+    for (size_t s = 0; s < copies.size(); ++s) {
+        if (copies[s]) {
+            next.deletions[s] = std::move(copies[s]);
+        }
+    }
+    pendingDeletions.clear();
+}
+
+void IndexHandler::mergeLoop() {
+    std::unique_lock<std::mutex> lock(mergeMutex);
+    while (true) {
+        mergeWake.wait(lock, [this] { return stopMerging || mergeRequested; });
+        if (stopMerging) break;
+        mergeRequested = false;
+        merging = true;
+        lock.unlock();
+        while (mergeOnce()) {}
+        lock.lock();
+        merging = false;
+        if (!mergeRequested) {
+            mergeIdle.notify_all();
+        }
+    }
+}
+
+bool IndexHandler::mergeOnce() {
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    std::vector<size_t> liveDocuments;
+    std::vector<size_t> deletedDocuments;
+    for (size_t s = 0; s < current->segments.size(); ++s) {
+        size_t deleted = current->deletions[s] ? current->deletions[s]->size() : 0;
+        liveDocuments.push_back(current->segments[s]->liveDocumentCount() - deleted);
+        deletedDocuments.push_back(deleted);
+    }
+
+    size_t first = 0;
+    size_t count = 0;
+    double bytesPerSecond;
+    double cpuShare;
+    {
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        if (stopMerging || !mergePolicy.findMerge(liveDocuments, deletedDocuments, first, count)) {
+            return false;
+        }
+        bytesPerSecond = mergeBytesPerSecond;
+        cpuShare = mergeCpuShare;
+    }
+
+    // Segments are immutable, so the merge reads them without any lock
+    std::vector<std::shared_ptr<const Segment>> inputs(current->segments.begin() + first,
+                                                       current->segments.begin() + first + count);
+    std::vector<std::shared_ptr<const DeletedDocs>> inputDeletions(current->deletions.begin() + first,
+                                                                   current->deletions.begin() + first + count);
+    auto started = std::chrono::steady_clock::now();
+    MergeThrottle throttle(bytesPerSecond, cpuShare, &stopMerging);
+    std::shared_ptr<const Segment> merged = Segment::merge(inputs, inputDeletions, &throttle);
+    if (!merged) {
+        return false;
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - started;
+
+    {
+        // Segments may have been published meanwhile, or the index
+        // reloaded; swap the merged segment in only where its inputs are
+        std::lock_guard<std::mutex> lock(writeMutex);
+        std::shared_ptr<const Snapshot> latest = currentSnapshot();
+        auto run = std::search(latest->segments.begin(), latest->segments.end(), inputs.begin(), inputs.end());
+        if (run == latest->segments.end()) {
+            return true;
+        }
+        size_t at = run - latest->segments.begin();
+
+        // Documents deleted from the inputs during the merge are still in
+        // the merged segment; carry their marks over
+        std::shared_ptr<DeletedDocs> carried;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& deleted = latest->deletions[at + i];
+            if (!deleted || deleted == inputDeletions[i]) continue;
+            for (uint32_t docId = inputs[i]->baseDocId(); docId < inputs[i]->endDocId(); ++docId) {
+                if (deleted->contains(docId) && !merged->isRemoved(docId)) {
+                    if (!carried) {
+                        carried = std::make_shared<DeletedDocs>(merged->baseDocId(), merged->endDocId());
+                    }
+                    carried->add(docId);
+                }
+            }
+        }
+
+        auto next = std::make_shared<Snapshot>(*latest);
+        next->segments.erase(next->segments.begin() + at, next->segments.begin() + at + count);
+        next->segments.insert(next->segments.begin() + at, merged);
+        next->deletions.erase(next->deletions.begin() + at, next->deletions.begin() + at + count);
+        next->deletions.insert(next->deletions.begin() + at, carried);
+        std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+    }
+
+    std::lock_guard<std::mutex> lock(mergeMutex);
+    stats.merges++;
+    stats.segmentsMerged += count;
+    stats.documentsMerged += merged->documentCount();
+    size_t removedBefore = 0;
+    for (const auto& input : inputs) {
+        removedBefore += input->removedCount();
+    }
+    stats.documentsRemoved += merged->removedCount() - removedBefore;
+    stats.bytesMerged += throttle.bytesWritten();
+    stats.mergeSeconds += seconds.count();
+    return true;
+}
+
+void IndexHandler::setMergePolicy(const TieredMergePolicy& policy) {
+    std::lock_guard<std::mutex> lock(mergeMutex);
+    mergePolicy = policy;
+}
+
+void IndexHandler::setMergeBudget(double bytesPerSecond, double cpuShare) {
+    std::lock_guard<std::mutex> lock(mergeMutex);
+    mergeBytesPerSecond = bytesPerSecond;
+    mergeCpuShare = cpuShare;
+}
+
+void IndexHandler::waitForMerges() {
+    std::unique_lock<std::mutex> lock(mergeMutex);
+    mergeIdle.wait(lock, [this] { return stopMerging || (!mergeRequested && !merging); });
+}
+
+MergeStats IndexHandler::mergeStats() const {
+    MergeStats result;
+    {
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        result = stats;
+    }
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    result.segmentCount = current->segments.size();
+    for (const auto& deleted : current->deletions) {
+        result.deletedDocuments += deleted ? deleted->size() : 0;
+    }
+    return result;
+}
+
+std::shared_ptr<const IndexHandler::Snapshot> IndexHandler::currentSnapshot() const {
+    return std::atomic_load(&snapshot);
+}
+
+size_t IndexHandler::segmentCount() const {
+    return currentSnapshot()->segments.size();
+}
+
+size_t IndexHandler::Snapshot::segmentIndex(uint32_t docId) const {
+    auto it = std::upper_bound(segments.begin(), segments.end(), docId,
+                               [](uint32_t id, const auto& segment) { return id < segment->baseDocId(); });
+    if (it == segments.begin() || docId >= (*(it - 1))->endDocId()) {
+        return segments.size();
+    }
+    return (it - 1) - segments.begin();
+}
+
+const Segment* IndexHandler::Snapshot::segmentFor(uint32_t docId) const {
+    size_t s = segmentIndex(docId);
+    return s < segments.size() ? segments[s].get() : nullptr;
+}
+
+bool IndexHandler::Snapshot::isDeleted(uint32_t docId) const {
+    size_t s = segmentIndex(docId);
+    return s < segments.size() &&
+           (segments[s]->isRemoved(docId) || (deletions[s] && deletions[s]->contains(docId)));
+}
+
+PostingListView IndexHandler::findQueryPostings(const Segment& segment, IndexField field,
+                                                const std::string& key, QueryLists& lists) const {
+    std::string word;
+    uint32_t maxDistance = 0;
+    bool fuzzy = LevenshteinAutomaton::parse(key, word, maxDistance);
+    if (!fuzzy && (field != IndexField::TERMS || !WildcardPattern::isPattern(key))) {
+        return segment.find(field, key);
+    }
+
+    const TermDictionary& keys = segment.dictionary(field);
+    bool truncated;
+    std::vector<size_t> ordinals = fuzzy ? LevenshteinAutomaton(word, maxDistance).expand(keys, truncated)
+                                         : WildcardPattern(key).expand(keys, segment.suffixes(field), truncated);
+    std::vector<PostingListView> postings;
+    for (size_t ordinal : ordinals) {
+        postings.push_back(segment.postingsAt(field, ordinal));
+    }
+    lists.truncated = lists.truncated || truncated;
+
+    if (postings.size() == 1) {
+        return postings[0];
+    }
+    lists.lists.push_back(unionPostings(segment, postings));
+    return lists.lists.back().view();
+}
+
+PostingList IndexHandler::unionPostings(const Segment& segment,
+                                        const std::vector<PostingListView>& postings) const {
+    // k-way merge: a min-heap holds the list index of every unfinished
+    // iterator, ordered by its current docId
+    std::vector<PostingIterator> its;
+    for (const auto& view : postings) {
+        its.push_back(view.iterator());
+    }
+    auto later = [&its](size_t a, size_t b) { return its[a].docId() > its[b].docId(); };
+    std::vector<size_t> heap;
+    for (size_t i = 0; i < its.size(); ++i) {
+        if (its[i].docId() != PostingIterator::END) {
+            heap.push_back(i);
+        }
     }
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    PostingList merged;
+    while (!heap.empty()) {
+        uint32_t docId = its[heap.front()].docId();
+        uint32_t frequency = 0;
+        while (!heap.empty() && its[heap.front()].docId() == docId) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            PostingIterator& it = its[heap.back()];
+            frequency += it.frequency();
+            if (it.next() == PostingIterator::END) {
+                heap.pop_back();
+            } else {
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+        merged.append(docId, frequency, segment.documentLength(docId));
+    }
+    merged.seal();
+    return merged;
+}
+
+
+bool IndexHandler::hasPositions() const {
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    return current->segments.empty() ? storePositions : current->positions;
+}
+
+std::shared_ptr<Document> IndexHandler::loadDocument(uint32_t docId) const {
+    if (currentSnapshot()->isDeleted(docId)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return documentStore->load(docId);
+}
+
+void IndexHandler::collectDocIds(const PostingListView& postings, const DeletedDocs* deleted,
+                                 std::vector<uint32_t>& docIds) {
+    docIds.reserve(docIds.size() + postings.documentCount);
+    for (auto it = postings.iterator(); it.docId() != PostingIterator::END; it.next()) {
+        if (!deleted || !deleted->contains(it.docId())) {
+            docIds.push_back(it.docId());
+        }
+    }
+}
+
+std::vector<std::shared_ptr<Document>> IndexHandler::resolveDocuments(
+    const Snapshot& current, const std::vector<uint32_t>& docIds) const {
+    std::vector<std::shared_ptr<Document>> docs;
+    docs.reserve(docIds.size());
+    for (uint32_t docId : docIds) {
+        const Segment* segment = current.segmentFor(docId);
+        if (auto doc = segment ? segment->loadSummary(docId) : nullptr) {
+            docs.push_back(doc);
+        }
+    }
+    return docs;
+}
+
+std::vector<std::shared_ptr<Document>> IndexHandler::searchField(IndexField field, const std::string& key) const {
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    std::vector<uint32_t> docIds;
+    for (size_t s = 0; s < current->segments.size(); ++s) {
+        QueryLists queryLists;
+        collectDocIds(findQueryPostings(*current->segments[s], field, key, queryLists),
+                      current->deletions[s].get(), docIds);
+    }
+    return resolveDocuments(*current, docIds);
 }
 
 std::vector<std::shared_ptr<Document>> IndexHandler::search(const std::string& term) const {
-    return termIndex.find(term);
+    return searchField(IndexField::TERMS, term);
 }
 
 std::vector<std::shared_ptr<Document>> IndexHandler::searchOrganization(const std::string& org) const {
-    return orgIndex.find(org);
+    return searchField(IndexField::ORGANIZATIONS, org);
 }
 
 std::vector<std::shared_ptr<Document>> IndexHandler::searchPerson(const std::string& person) const {
-    return personIndex.find(person);
+    return searchField(IndexField::PERSONS, person);
 }
 
 std::vector<std::shared_ptr<Document>> IndexHandler::getRelevantDocuments(
@@ -83,114 +478,299 @@ std::vector<std::shared_ptr<Document>> IndexHandler::getRelevantDocuments(
     const std::vector<std::string>& excludedTerms,
     const std::vector<std::string>& organizations,
     const std::vector<std::string>& persons) const {
-    
-    std::vector<std::shared_ptr<Document>> results;
-    
+    QueryPlan plan;
+    plan.terms = terms;
+    plan.excludedTerms = excludedTerms;
+    plan.organizations = organizations;
+    plan.persons = persons;
+    return getTopDocuments(plan, std::numeric_limits<size_t>::max()).documents;
+}
+
+SearchResults IndexHandler::getTopDocuments(const QueryPlan& plan, size_t limit, size_t offset) const {
     // If no terms provided, return empty result
-    if (terms.empty() && organizations.empty() && persons.empty()) {
-        return results;
+    if (plan.empty()) {
+        return SearchResults();
+    }
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+    bool any = plan.matchMode == MatchMode::ANY && !plan.terms.empty();
+
+    // Look every key up in every segment first: a term's document frequency
+    // is its total over all of them. Deleted documents stay in the lists
+    // until merged away, so each segment's count is scaled down by its
+    // share of deleted documents.
+    std::vector<SegmentQuery> queries(current->segments.size());
+    std::vector<double> documentFrequencies(plan.terms.size());
+    for (size_t s = 0; s < queries.size(); ++s) {
+        const Segment& segment = *current->segments[s];
+        SegmentQuery& query = queries[s];
+        query.segment = &segment;
+        query.deleted = current->deletions[s].get();
+        double liveShare = query.deleted && segment.liveDocumentCount() > 0
+            ? 1.0 - static_cast<double>(query.deleted->size()) / segment.liveDocumentCount() : 1.0;
+        for (size_t t = 0; t < plan.terms.size(); ++t) {
+            query.terms.push_back(findQueryPostings(segment, IndexField::TERMS, plan.terms[t], query.queryLists));
+            documentFrequencies[t] += query.terms.back().documentCount * liveShare;
+        }
+        for (const auto& org : plan.organizations) {
+            query.required.push_back(findQueryPostings(segment, IndexField::ORGANIZATIONS, org, query.queryLists));
+        }
+        for (const auto& person : plan.persons) {
+            query.required.push_back(findQueryPostings(segment, IndexField::PERSONS, person, query.queryLists));
+        }
+        for (const auto& excludedTerm : plan.excludedTerms) {
+            query.excluded.push_back(findQueryPostings(segment, IndexField::TERMS, excludedTerm, query.queryLists));
+        }
+    }
+
+    double averageLength = current->documentCount
+        ? static_cast<double>(current->totalDocumentLength) / current->documentCount : 0.0;
+    Bm25 bm25(current->documentCount, averageLength);
+    std::vector<double> idfs;
+    for (double frequency : documentFrequencies) {
+        idfs.push_back(bm25.idf(static_cast<uint32_t>(std::lround(frequency))));
+    }
+
+    // Segments hold disjoint docIds, so one collector ranks them all, and
+    // in ANY mode its threshold keeps pruning from one segment to the next
+    TopKCollector topK(pageEnd(limit, offset));
+    size_t matches = 0;
+    bool truncated = false;
+    for (auto& query : queries) {
+        matches += any ? rankAny(query, plan, bm25, idfs, topK) : rankAll(query, plan, bm25, idfs, topK);
+        truncated = truncated || query.queryLists.truncated;
+    }
+
+    // Once the heap filled up, documents pruned by ANY went uncounted
+    bool exactTotal = !any || !topK.full();
+    SearchResults page = resolvePage(*current, topK.takeSorted(), offset);
+    page.totalMatches = matches;
+    page.exactTotal = exactTotal;
+    page.truncatedExpansion = truncated;
+    return page;
+}
+
+size_t IndexHandler::rankAll(SegmentQuery& query, const QueryPlan& plan, const Bm25& bm25,
+                             const std::vector<double>& idfs, TopKCollector& topK) const {
+    const Segment& segment = *query.segment;
+
+    // Every term, organization and person list must contain a match; only
+    // the terms contribute to its score
+    struct RequiredList {
+        PostingIterator it;
+        size_t documentCount;
+    };
+    std::vector<RequiredList> lists;
+    for (const auto& postings : query.terms) {
+        lists.push_back({postings.iterator(), postings.documentCount});
+    }
+    for (const auto& postings : query.required) {
+        lists.push_back({postings.iterator(), postings.documentCount});
+    }
+
+    // Drive the intersection from the shortest list; the longer lists are
+    // only probed with advance(), which skips whole blocks and gallops
+    // within one
+    std::vector<RequiredList*> byLength;
+    for (auto& list : lists) {
+        byLength.push_back(&list);
+    }
+    std::stable_sort(byLength.begin(), byLength.end(), [](const RequiredList* a, const RequiredList* b) {
+        return a->documentCount < b->documentCount;
+    });
+    if (byLength[0]->documentCount == 0) {
+        return 0;
+    }
+
+    std::vector<PostingIterator> excluded;
+    for (const auto& postings : query.excluded) {
+        excluded.push_back(postings.iterator());
+    }
+    std::vector<ProximityMatcher> matchers = makeMatchers(segment, plan.proximities);
+
+    // Single pass: every document in all lists is checked against the
+    // exclusions, scored and offered to the heap as soon as it is found
+    size_t matches = 0;
+    uint32_t candidate = byLength[0]->it.docId();
+    while (candidate != PostingIterator::END) {
+        size_t i = 1;
+        for (; i < byLength.size(); ++i) {
+            if (byLength[i]->it.advance(candidate) != candidate) break;
+        }
+        if (i < byLength.size()) {
+            // The probed list has no candidate; leap to where it continues
+            candidate = byLength[0]->it.advance(byLength[i]->it.docId());
+            continue;
+        }
+
+        // Deleted documents stay in the lists until their segment is merged
+        bool isExcluded = query.deleted && query.deleted->contains(candidate);
+        for (size_t e = 0; e < excluded.size() && !isExcluded; ++e) {
+            isExcluded = excluded[e].advance(candidate) == candidate;
+        }
+
+        // Positions are only decoded for documents that got this far
+        for (size_t c = 0; c < matchers.size() && !isExcluded; ++c) {
+            isExcluded = !matchers[c].matches(candidate);
+        }
+        if (!isExcluded) {
+            // Sum in query order so scores do not depend on list lengths
+            double score = 0.0;
+            uint32_t length = segment.documentLength(candidate);
+            for (size_t t = 0; t < idfs.size(); ++t) {
+                score += bm25.score(idfs[t], lists[t].it.frequency(), length);
+            }
+            topK.offer(score, candidate);
+            matches++;
+        }
+        candidate = byLength[0]->it.next();
+    }
+    return matches;
+}
+
+size_t IndexHandler::rankAny(SegmentQuery& query, const QueryPlan& plan, const Bm25& bm25,
+                             const std::vector<double>& idfs, TopKCollector& topK) const {
+    const Segment& segment = *query.segment;
+    BlockMaxWand wand(bm25, [&segment](uint32_t docId) { return segment.documentLength(docId); });
+    for (size_t t = 0; t < query.terms.size(); ++t) {
+        wand.addTerm(query.terms[t], idfs[t]);
     }
 
-    // Get initial results from first term
-    if (!terms.empty()) {
-        results = search(terms[0]);
-    } else if (!organizations.empty()) {
-        results = searchOrganization(organizations[0]);
+    // Candidates arrive in docId order, so each filter list is walked once
+    std::vector<PostingIterator> required;
+    for (const auto& postings : query.required) {
+        required.push_back(postings.iterator());
+    }
+    std::vector<PostingIterator> excluded;
+    for (const auto& postings : query.excluded) {
+        excluded.push_back(postings.iterator());
+    }
+    std::vector<ProximityMatcher> matchers = makeMatchers(segment, plan.proximities);
+    const DeletedDocs* deleted = query.deleted;
+    auto accept = [deleted, &required, &excluded, &matchers](uint32_t docId) {
+        if (deleted && deleted->contains(docId)) return false;
+        for (auto& it : required) {
+            if (it.advance(docId) != docId) return false;
+        }
+        for (auto& it : excluded) {
+            if (it.advance(docId) == docId) return false;
+        }
+        for (auto& matcher : matchers) {
+            if (!matcher.matches(docId)) return false;
+        }
+        return true;
+    };
+
+    return wand.run(topK, accept);
+}
+
+std::vector<ProximityMatcher> IndexHandler::makeMatchers(const Segment& segment,
+                                                         const std::vector<ProximityClause>& proximities) const {
+    std::vector<ProximityMatcher> matchers;
+    if (!segment.hasPositions()) {
+        return matchers;
+    }
+    for (const auto& clause : proximities) {
+        std::vector<PostingListView> postings;
+        for (const auto& term : clause.terms) {
+            postings.push_back(segment.find(IndexField::TERMS, term));
+        }
+        matchers.emplace_back(clause, postings);
+    }
+    return matchers;
+}
+
+SearchResults IndexHandler::resolvePage(const Snapshot& current, const std::vector<ScoredDoc>& ranked,
+                                        size_t offset) const {
+    std::vector<uint32_t> docIds;
+    for (size_t i = offset; i < ranked.size(); ++i) {
+        docIds.push_back(ranked[i].docId);
+    }
+    SearchResults page;
+    page.documents = resolveDocuments(current, docIds);
+    return page;
+}
+
+void IndexHandler::saveIndices(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    publishSegment();
+    std::shared_ptr<const Snapshot> current = currentSnapshot();
+
+    // Deleted documents are removed on the way, as in any merge
+    bool deletions = std::any_of(current->deletions.begin(), current->deletions.end(),
+                                 [](const auto& deleted) { return deleted != nullptr; });
+    std::shared_ptr<const Segment> all = current->segments.size() == 1 && !deletions
+        ? current->segments[0] : Segment::merge(current->segments, current->deletions);
+
+    // Removed documents leave the files for good: the others are renumbered
+    // from 0, and their postings and stored documents rewritten
+    std::unique_ptr<DocumentStore> compacted;
+    if (all->removedCount() > 0) {
+        compacted = std::make_unique<DocumentStore>();
+        {
+            std::lock_guard<std::mutex> storeLock(storeMutex);
+            for (uint32_t docId = 0; docId < all->endDocId(); ++docId) {
+                if (!all->isRemoved(docId)) {
+                    compacted->add(*documentStore->load(docId));
+                }
+            }
+        }
+        all = Segment::compact(*all);
+    }
+
+    // Write next to the destination and rename over it, so a segment
+    // mapping the old files keeps reading them intact
+    std::string temporary = filePath + ".tmp";
+    bool written = all->write(temporary);
+    if (compacted) {
+        written = written && compacted->write(temporary + ".docs");
     } else {
-        results = searchPerson(persons[0]);
-    }
-
-    // Intersect with other terms
-    for (size_t i = 1; i < terms.size(); ++i) {
-        auto termDocs = search(terms[i]);
-        std::vector<std::shared_ptr<Document>> intersection;
-        
-        std::set_intersection(
-            results.begin(), results.end(),
-            termDocs.begin(), termDocs.end(),
-            std::back_inserter(intersection)
-        );
-        
-        results = intersection;
-    }
-
-    // Filter by organizations
-    for (const auto& org : organizations) {
-        auto orgDocs = searchOrganization(org);
-        std::vector<std::shared_ptr<Document>> intersection;
-        
-        std::set_intersection(
-            results.begin(), results.end(),
-            orgDocs.begin(), orgDocs.end(),
-            std::back_inserter(intersection)
-        );
-        
-        results = intersection;
-    }
-
-    // Filter by persons
-    for (const auto& person : persons) {
-        auto personDocs = searchPerson(person);
-        std::vector<std::shared_ptr<Document>> intersection;
-        
-        std::set_intersection(
-            results.begin(), results.end(),
-            personDocs.begin(), personDocs.end(),
-            std::back_inserter(intersection)
-        );
-        
-        results = intersection;
-    }
-
-    // Remove documents containing excluded terms
-    for (const auto& excludedTerm : excludedTerms) {
-        auto excludedDocs = search(excludedTerm);
-        std::vector<std::shared_ptr<Document>> difference;
-        
-        std::set_difference(
-            results.begin(), results.end(),
-            excludedDocs.begin(), excludedDocs.end(),
-            std::back_inserter(difference)
-        );
-        
-        results = difference;
-    }
-
-    // Calculate TF-IDF scores and sort results
-    std::vector<std::pair<double, std::shared_ptr<Document>>> scoredDocs;
-    int totalDocs = documentStore.size();
-
-    for (const auto& doc : results) {
-        double score = 0.0;
-        for (const auto& term : terms) {
-            score += calculateTfIdf(term, doc, totalDocs);
-        }
-        scoredDocs.emplace_back(score, doc);
-    }
-
-    // Sort by score in descending order
-    std::sort(scoredDocs.begin(), scoredDocs.end(),
-        [](const auto& a, const auto& b) { return a.first > b.first; });
-
-    // Extract sorted documents
-    results.clear();
-    for (const auto& [score, doc] : scoredDocs) {
-        results.push_back(doc);
-    }
-
-    return results;
-}
-
-double IndexHandler::calculateTfIdf(const std::string& term, 
-                                  const std::shared_ptr<Document>& doc,
-                                  int totalDocs) const {
-    // Calculate TF (term frequency)
-    double tf = static_cast<double>(doc->getTermFrequency(term));
-    
-    // Calculate IDF (inverse document frequency)
-    auto docsWithTerm = search(term);
-    double idf = std::log(static_cast<double>(totalDocs) / 
-                         (1 + static_cast<double>(docsWithTerm.size())));
-    
-    return tf * idf;
-} 
\ No newline at end of file
+        std::lock_guard<std::mutex> storeLock(storeMutex);
+        written = written && documentStore->write(temporary + ".docs");
+    }
+    written = written && current->stopWords.write(temporary + ".stopwords");
+    if (!written ||
+        std::rename(temporary.c_str(), filePath.c_str()) != 0 ||
+        std::rename((temporary + ".docs").c_str(), (filePath + ".docs").c_str()) != 0 ||
+        std::rename((temporary + ".stopwords").c_str(), (filePath + ".stopwords").c_str()) != 0) {
+        std::remove(temporary.c_str());
+        std::remove((temporary + ".docs").c_str());
+        std::remove((temporary + ".stopwords").c_str());
+        throw std::runtime_error("Failed writing index " + filePath);
+    }
+}
+
+void IndexHandler::loadIndices(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // The store is mapped once and shared with the segment
+    auto store = std::make_shared<DocumentStore>();
+    if (!store->open(filePath + ".docs")) {
+        throw std::runtime_error("Cannot open document store " + filePath + ".docs");
+    }
+    std::shared_ptr<const Segment> segment = Segment::open(filePath, store);
+
+    // Indexes saved before stopword lists were kept used the built-in one
+    StopWords loadedStopWords;
+    if (std::ifstream(filePath + ".stopwords")) {
+        loadedStopWords = StopWords::fromFile(filePath + ".stopwords");
+    }
+    {
+        std::lock_guard<std::mutex> storeLock(storeMutex);
+        documentStore = std::move(store);
+    }
+
+    // Documents added from now on follow the loaded ones
+    storePositions = segment->hasPositions();
+    builder.reset(segment->endDocId(), storePositions);
+    pendingDeletions.clear();
+    documentIds.clear();
+    documentIdsComplete = false;
+
+    auto next = std::make_shared<Snapshot>();
+    next->segments.push_back(segment);
+    next->deletions.push_back(nullptr);
+    next->documentCount = segment->liveDocumentCount();
+    next->totalDocumentLength = segment->totalDocumentLength();
+    next->positions = segment->hasPositions();
+    next->stopWords = std::move(loadedStopWords);
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+}
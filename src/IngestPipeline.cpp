@@ -0,0 +1,152 @@
+#include "IngestPipeline.h"
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "BoundedQueue.h"
+#include "DocumentParser.h"
+
+namespace {
+
+// Work items carry their position in the directory walk so results can be
+// put back in order
+struct PathItem {
+    size_t sequence;
+    std::string path;
+};
+
+struct DocumentItem {
+    size_t sequence;
+    std::unique_ptr<Document> doc;  // nullptr if the file failed to parse
+};
+
+// Admission control for the reorder buffer: a result may only be handed in
+// once it is within capacity of the next sequence the sink is waiting for,
+// so one slow file cannot make the buffer grow with the rest of the walk
+class ReorderWindow {
+public:
+    explicit ReorderWindow(size_t capacity) : capacity(capacity), next(0), closed(false) {}
+
+    // Wait until sequence fits in the window; false if the window was closed
+    bool admit(size_t sequence) {
+        std::unique_lock<std::mutex> lock(mutex);
+        moved.wait(lock, [&] { return closed || sequence < next + capacity; });
+        return !closed;
+    }
+
+    void advance(size_t nextSequence) {
+        std::lock_guard<std::mutex> lock(mutex);
+        next = nextSequence;
+        moved.notify_all();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        moved.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable moved;
+    size_t capacity;
+    size_t next;
+    bool closed;
+};
+
+} // namespace
+
+IngestPipeline::IngestPipeline(size_t threadCount, size_t queueCapacity)
+    : threadCount(threadCount), queueCapacity(queueCapacity) {
+    if (this->threadCount == 0) {
+        this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (this->queueCapacity == 0) {
+        this->queueCapacity = 1;
+    }
+}
+
+size_t IngestPipeline::run(const std::string& directoryPath, const Sink& sink) {
+    BoundedQueue<PathItem> paths(queueCapacity);
+    BoundedQueue<DocumentItem> parsed(queueCapacity);
+    ReorderWindow window(queueCapacity);
+
+    std::thread walker([&paths, &directoryPath] {
+        size_t sequence = 0;
+        DocumentParser::forEachJsonFile(directoryPath, [&](const std::string& path) {
+            return paths.push({sequence++, path});
+        });
+        paths.close();
+    });
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this, &paths, &parsed, &window] {
+            DocumentParser parser;
+            parser.setStopWords(stopWords);
+            PathItem item;
+            while (paths.pop(item)) {
+                std::unique_ptr<Document> doc;
+                try {
+                    doc = parser.parseDocument(item.path);
+                } catch (const std::exception& e) {
+                    // Treat like any other unparseable file
+                }
+                // Paths are handed out in order, so the sequence the sink is
+                // waiting for is always admitted and this cannot deadlock
+                if (!window.admit(item.sequence) ||
+                    !parsed.push({item.sequence, std::move(doc)})) {
+                    break;
+                }
+            }
+        });
+    }
+
+    // Close the results queue once the last worker is done
+    std::thread closer([&workers, &parsed] {
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        parsed.close();
+    });
+
+    auto shutdown = [&] {
+        paths.close();
+        parsed.close();
+        window.close();
+        walker.join();
+        closer.join();
+    };
+
+    // Single indexing stage: reorder and deliver in directory order. Every
+    // buffered sequence is below nextSequence + queueCapacity.
+    size_t delivered = 0;
+    size_t nextSequence = 0;
+    std::map<size_t, std::unique_ptr<Document>> pending;
+    try {
+        DocumentItem item;
+        while (parsed.pop(item)) {
+            pending.emplace(item.sequence, std::move(item.doc));
+            size_t first = nextSequence;
+            for (auto it = pending.begin(); it != pending.end() && it->first == nextSequence;
+                 it = pending.erase(it), ++nextSequence) {
+                if (it->second) {
+                    sink(std::move(it->second));
+                    delivered++;
+                }
+            }
+            if (nextSequence != first) {
+                window.advance(nextSequence);
+            }
+        }
+    } catch (...) {
+        shutdown();
+        throw;
+    }
+
+    shutdown();
+    return delivered;
+}
@@ -0,0 +1,151 @@
+#include "LevenshteinAutomaton.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Keys stepped over one by one before a dead prefix is skipped with a seek
+constexpr size_t SEEK_AFTER = 8;
+
+char foldCase(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+size_t commonPrefix(std::string_view a, std::string_view b) {
+    size_t limit = std::min(a.size(), b.size());
+    size_t length = 0;
+    while (length < limit && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+// Smallest string above every string starting with prefix; empty if none
+std::string successor(std::string prefix) {
+    while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xFF) {
+        prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+        prefix.back() = static_cast<char>(static_cast<unsigned char>(prefix.back()) + 1);
+    }
+    return prefix;
+}
+
+} // namespace
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view text, uint32_t distance)
+    : maxDistance(std::min(distance, MAX_DISTANCE)) {
+    for (char c : text) {
+        word += foldCase(c);
+    }
+}
+
+bool LevenshteinAutomaton::parse(std::string_view term, std::string& word, uint32_t& distance) {
+    size_t tilde = term.rfind('~');
+    if (tilde == std::string_view::npos || tilde == 0) {
+        return false;
+    }
+    std::string_view suffix = term.substr(tilde + 1);
+    if (suffix.size() > 1 || (suffix.size() == 1 && (suffix[0] < '0' || suffix[0] > '9'))) {
+        return false;
+    }
+
+    distance = suffix.empty() ? MAX_DISTANCE : std::min<uint32_t>(suffix[0] - '0', MAX_DISTANCE);
+    word.assign(term.data(), tilde);
+    return true;
+}
+
+bool LevenshteinAutomaton::step(const uint8_t* row, uint8_t* next, char c) const {
+    uint8_t limit = static_cast<uint8_t>(maxDistance + 1);
+    c = foldCase(c);
+    next[0] = std::min<uint8_t>(row[0] + 1, limit);
+    bool alive = next[0] < limit;
+    for (size_t i = 1; i <= word.size(); ++i) {
+        uint8_t cost = row[i - 1] + (word[i - 1] != c ? 1 : 0);
+        cost = std::min<uint8_t>(cost, row[i] + 1);
+        cost = std::min<uint8_t>(cost, next[i - 1] + 1);
+        next[i] = std::min(cost, limit);
+        alive = alive || next[i] < limit;
+    }
+    return alive;
+}
+
+uint32_t LevenshteinAutomaton::distance(std::string_view key) const {
+    size_t width = word.size() + 1;
+    std::vector<uint8_t> row(width);
+    std::vector<uint8_t> next(width);
+    for (size_t i = 0; i < width; ++i) {
+        row[i] = static_cast<uint8_t>(std::min<size_t>(i, maxDistance + 1));
+    }
+    for (char c : key) {
+        if (!step(row.data(), next.data(), c)) {
+            return maxDistance + 1;
+        }
+        row.swap(next);
+    }
+    return row[word.size()];
+}
+
+std::vector<size_t> LevenshteinAutomaton::expand(const TermDictionary& keys, bool& truncated) const {
+    // rows[j] is the state after the first j bytes of the previous key;
+    // the first validRows + 1 of them are up to date
+    size_t width = word.size() + 1;
+    std::vector<uint8_t> rows(width);
+    for (size_t i = 0; i < width; ++i) {
+        rows[i] = static_cast<uint8_t>(std::min<size_t>(i, maxDistance + 1));
+    }
+    std::string previous;
+    size_t validRows = 0;
+
+    std::vector<std::pair<uint8_t, size_t>> matches;
+    auto it = keys.cursor();
+    while (it.valid()) {
+        std::string_view key = it.key();
+        size_t depth = std::min(commonPrefix(previous, key), validRows);
+        if (rows.size() < (key.size() + 1) * width) {
+            rows.resize((key.size() + 1) * width);
+        }
+        bool alive = true;
+        while (alive && depth < key.size()) {
+            alive = step(&rows[depth * width], &rows[(depth + 1) * width], key[depth]);
+            ++depth;
+        }
+        previous.assign(key.data(), key.size());
+        validRows = depth;
+
+        if (alive) {
+            uint8_t distance = rows[key.size() * width + word.size()];
+            if (distance <= maxDistance) {
+                matches.emplace_back(distance, it.ordinal());
+            }
+            it.next();
+            continue;
+        }
+
+        // No key starting with previous[0, depth) can match. Step over the
+        // first few of them, then seek past the rest.
+        std::string_view dead(previous.data(), depth);
+        size_t steps = 0;
+        do {
+            it.next();
+        } while (it.valid() && ++steps < SEEK_AFTER && it.key().compare(0, depth, dead) == 0);
+        if (it.valid() && it.key().compare(0, depth, dead) == 0) {
+            std::string next = successor(std::string(dead));
+            if (next.empty()) break;
+            it = keys.cursor(keys.lowerBound(next));
+        }
+    }
+
+    // Keep the closest matches
+    truncated = matches.size() > MAX_EXPANSIONS;
+    if (truncated) {
+        std::nth_element(matches.begin(), matches.begin() + MAX_EXPANSIONS, matches.end());
+        matches.resize(MAX_EXPANSIONS);
+    }
+    std::vector<size_t> ordinals;
+    for (const auto& match : matches) {
+        ordinals.push_back(match.second);
+    }
+    std::sort(ordinals.begin(), ordinals.end());
+    return ordinals;
+}
@@ -0,0 +1,43 @@
+#include "MergeThrottle.h"
+#include <algorithm>
+#include <thread>
+
+MergeThrottle::MergeThrottle(double bytesPerSecond, double cpuShare, const std::atomic<bool>* cancelled)
+    : bytesPerSecond(bytesPerSecond), cpuShare(cpuShare), cancelled(cancelled),
+      start(Clock::now()), slept(Clock::duration::zero()), total(0), unchecked(0) {}
+
+bool MergeThrottle::pace(size_t bytes) {
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+        return false;
+    }
+    total += bytes;
+    unchecked += bytes;
+    if (unchecked < CHECK_BYTES) {
+        return true;
+    }
+    unchecked = 0;
+
+    using Seconds = std::chrono::duration<double>;
+    Clock::time_point now = Clock::now();
+    double elapsed = Seconds(now - start).count();
+    double wait = 0.0;
+
+    // I/O: the bytes so far may not take less than total / bytesPerSecond
+    if (bytesPerSecond > 0) {
+        wait = std::max(wait, total / bytesPerSecond - elapsed);
+    }
+
+    // CPU: time spent working, as opposed to sleeping here, may only be
+    // cpuShare of the time elapsed
+    if (cpuShare > 0 && cpuShare < 1) {
+        double busy = elapsed - Seconds(slept).count();
+        wait = std::max(wait, busy / cpuShare - elapsed);
+    }
+
+    if (wait > 0) {
+        auto duration = std::chrono::duration_cast<Clock::duration>(Seconds(wait));
+        std::this_thread::sleep_for(duration);
+        slept += Clock::now() - now;
+    }
+    return !(cancelled && cancelled->load(std::memory_order_relaxed));
+}
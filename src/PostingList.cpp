@@ -0,0 +1,395 @@
+#include "PostingList.h"
+#include "BinaryIO.h"
+#include <algorithm>
+#include <cstring>
+
+using BinaryIO::readVarint;
+using BinaryIO::writeVarint;
+
+namespace {
+
+uint32_t readUint32(const uint8_t* in) {
+    return BinaryIO::load<uint32_t>(in);
+}
+
+void writeUint32(uint8_t* out, uint32_t value) {
+    BinaryIO::store<uint32_t>(out, value);
+}
+
+// First index in [from, count) whose docId (every stride-th value) is >=
+// target, or count. Probes 1, 2, 4, ... ahead, then binary searches the
+// last step, so short hops stay cheap and long ones take O(log n).
+size_t gallop(const uint32_t* docIds, size_t stride, size_t from, size_t count, uint32_t target) {
+    size_t low = from;
+    size_t step = 1;
+    while (low + step < count && docIds[(low + step) * stride] < target) {
+        low += step;
+        step *= 2;
+    }
+    size_t high = std::min(low + step, count);
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (docIds[mid * stride] < target) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+} // namespace
+
+PostingList::PostingList()
+    : documentCount(0), lastDoc(0), maxFrequency(0),
+      minLength(UINT32_MAX), pendingMinLength(UINT32_MAX),
+      positionedCount(0), lastPosition(0) {}
+
+void PostingList::add(uint32_t docId, uint32_t documentLength) {
+    // Repeat occurrence in the same document only bumps the frequency
+    if (!pending.empty() && pending[pending.size() - 2] == docId) {
+        pending.back()++;
+        return;
+    }
+    append(docId, 1, documentLength);
+}
+
+void PostingList::append(uint32_t docId, uint32_t frequency, uint32_t documentLength) {
+    // A full block is only encoded once the next document arrives, so the
+    // last document's frequency can keep growing until then
+    if (pending.size() / 2 == BLOCK_SIZE) {
+        flushBlock();
+    }
+
+    pending.push_back(docId);
+    pending.push_back(frequency);
+    documentCount++;
+    lastDoc = docId;
+    pendingMinLength = std::min(pendingMinLength, documentLength);
+}
+
+void PostingList::addPosition(uint32_t position) {
+    if (positionedCount < documentCount) {
+        // First position of the last document starts its record
+        if (positionedCount % POSITION_INTERVAL == 0) {
+            positionCheckpoints.push_back(static_cast<uint32_t>(positionData.size()));
+        }
+        positionData.push_back(0);
+        writeVarint(positionData, position + 1);
+        positionedCount++;
+    } else {
+        writeVarint(positionData, position - lastPosition);
+    }
+    lastPosition = position;
+}
+
+void PostingList::appendList(const PostingListView& postings, bool withPositions, const DeletedDocs* deleted) {
+    if (deleted && deleted->empty()) {
+        deleted = nullptr;
+    }
+
+    // Ordinals of the postings left out, so their positions are too
+    std::vector<size_t> dropped;
+    size_t ordinal = 0;
+    auto appendKept = [&](uint32_t docId, uint32_t frequency, uint32_t length) {
+        if (deleted && deleted->contains(docId)) {
+            dropped.push_back(ordinal);
+        } else {
+            append(docId, frequency, length);
+        }
+        ordinal++;
+    };
+
+    const uint8_t* in = postings.data;
+    const uint8_t* end = postings.data + postings.size;
+    while (in < end) {
+        size_t count = in[12];
+        size_t blockBytes = HEADER_SIZE + readUint32(in + 8);
+        if (count == BLOCK_SIZE && !(deleted && deleted->containsAny(readUint32(in), readUint32(in + 4)))) {
+            // Blocks decode on their own, so a full one is copied verbatim
+            // once the tail before it is encoded
+            if (!pending.empty()) {
+                flushBlock();
+            }
+            blocks.insert(blocks.end(), in, in + blockBytes);
+            documentCount += count;
+            lastDoc = readUint32(in + 4);
+            maxFrequency = std::max(maxFrequency, readUint32(in + 13));
+            minLength = std::min(minLength, readUint32(in + 17));
+            ordinal += count;
+        } else {
+            // The block's shortest length bounds each of its documents
+            uint32_t blockMinLength = readUint32(in + 17);
+            for (PostingIterator it(in, blockBytes); it.docId() != PostingIterator::END; it.next()) {
+                appendKept(it.docId(), it.frequency(), blockMinLength);
+            }
+        }
+        in += blockBytes;
+    }
+    for (size_t i = 0; i < postings.pendingCount; ++i) {
+        appendKept(postings.pending[2 * i], postings.pending[2 * i + 1], postings.minDocumentLength);
+    }
+
+    if (!withPositions || !postings.hasPositions()) {
+        return;
+    }
+    uint32_t offset = static_cast<uint32_t>(positionData.size());
+    if (dropped.empty() && positionedCount % POSITION_INTERVAL == 0) {
+        // Checkpoints line up with the appended ones, which just shift
+        size_t checkpoints = (postings.documentCount + POSITION_INTERVAL - 1) / POSITION_INTERVAL;
+        for (size_t i = 0; i < checkpoints; ++i) {
+            positionCheckpoints.push_back(offset + readUint32(postings.positionCheckpoints + 4 * i));
+        }
+        positionData.insert(positionData.end(), postings.positionData,
+                            postings.positionData + postings.positionSize);
+        positionedCount += postings.documentCount;
+        return;
+    }
+
+    // Copy the kept records one by one, found by their markers, noting
+    // those that now start an interval
+    const uint8_t* record = postings.positionData;
+    const uint8_t* recordsEnd = postings.positionData + postings.positionSize;
+    size_t nextDropped = 0;
+    for (size_t i = 0; i < postings.documentCount && record; ++i) {
+        const uint8_t* next = static_cast<const uint8_t*>(std::memchr(record + 1, 0, recordsEnd - record - 1));
+        if (nextDropped < dropped.size() && dropped[nextDropped] == i) {
+            nextDropped++;
+        } else {
+            if (positionedCount % POSITION_INTERVAL == 0) {
+                positionCheckpoints.push_back(static_cast<uint32_t>(positionData.size()));
+            }
+            positionData.insert(positionData.end(), record, next ? next : recordsEnd);
+            positionedCount++;
+        }
+        record = next;
+    }
+}
+
+void PostingList::seal() {
+    if (!pending.empty()) {
+        flushBlock();
+    }
+    blocks.shrink_to_fit();
+    positionData.shrink_to_fit();
+    positionCheckpoints.shrink_to_fit();
+}
+
+void PostingList::flushBlock() {
+    size_t count = pending.size() / 2;
+    size_t headerPos = blocks.size();
+    blocks.resize(headerPos + HEADER_SIZE);
+
+    // Docid gaps relative to the previous document in the block
+    for (size_t i = 1; i < count; ++i) {
+        writeVarint(blocks, pending[2 * i] - pending[2 * (i - 1)]);
+    }
+    uint32_t blockMaxFrequency = 0;
+    for (size_t i = 0; i < count; ++i) {
+        writeVarint(blocks, pending[2 * i + 1]);
+        blockMaxFrequency = std::max(blockMaxFrequency, pending[2 * i + 1]);
+    }
+
+    uint8_t* header = blocks.data() + headerPos;
+    writeUint32(header, pending[0]);
+    writeUint32(header + 4, pending[2 * (count - 1)]);
+    writeUint32(header + 8, static_cast<uint32_t>(blocks.size() - headerPos - HEADER_SIZE));
+    header[12] = static_cast<uint8_t>(count);
+    writeUint32(header + 13, blockMaxFrequency);
+    writeUint32(header + 17, pendingMinLength);
+
+    maxFrequency = std::max(maxFrequency, blockMaxFrequency);
+    minLength = std::min(minLength, pendingMinLength);
+    pendingMinLength = UINT32_MAX;
+    pending.clear();
+    pending.shrink_to_fit();
+}
+
+PostingIterator PostingList::iterator() const {
+    return view().iterator();
+}
+
+PostingListView PostingList::view() const {
+    PostingListView result;
+    result.data = blocks.data();
+    result.size = blocks.size();
+    result.pending = pending.data();
+    result.pendingCount = pending.size() / 2;
+    result.documentCount = documentCount;
+    result.maxFrequency = maxFrequency;
+    result.minDocumentLength = std::min(minLength, pendingMinLength);
+    for (size_t i = 1; i < pending.size(); i += 2) {
+        result.maxFrequency = std::max(result.maxFrequency, pending[i]);
+    }
+    if (!positionData.empty()) {
+        // Checkpoints are host-order u32s, the same bytes as the file on the
+        // little-endian machines BinaryIO assumes
+        result.positionCheckpoints = reinterpret_cast<const uint8_t*>(positionCheckpoints.data());
+        result.positionData = positionData.data();
+        result.positionSize = positionData.size();
+    }
+    return result;
+}
+
+size_t PostingList::memoryUsage() const {
+    return blocks.capacity() + pending.capacity() * sizeof(uint32_t) +
+           positionData.capacity() + positionCheckpoints.capacity() * sizeof(uint32_t);
+}
+
+bool PostingListView::positions(size_t ordinal, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (!hasPositions() || ordinal >= documentCount) {
+        return false;
+    }
+
+    // From the checkpoint, walk record markers up to this posting's record
+    const uint8_t* record = positionData + readUint32(positionCheckpoints + 4 * (ordinal / PostingList::POSITION_INTERVAL));
+    const uint8_t* end = positionData + positionSize;
+    for (size_t skip = ordinal % PostingList::POSITION_INTERVAL; skip > 0; --skip) {
+        record = static_cast<const uint8_t*>(std::memchr(record + 1, 0, end - record - 1));
+        if (!record) return false;
+    }
+
+    const uint8_t* in = record + 1;
+    uint32_t position = 0;
+    while (in < end && *in != 0) {
+        uint32_t delta;
+        in = readVarint(in, delta);
+        position += delta;
+        out.push_back(position - 1);
+    }
+    return true;
+}
+
+PostingIterator::PostingIterator(const uint8_t* data, size_t size,
+                                 const uint32_t* pending, size_t pendingCount)
+    : cursor(data), end(data + size), pending(pending), pendingCount(pendingCount),
+      inPending(false), blockCount(0), position(0), currentDoc(END),
+      boundLastDoc(END), boundMaxFrequency(0), boundMinLength(0),
+      blockBase(0), nextBase(0) {
+    if (!loadNextBlock()) {
+        loadPending();
+    }
+}
+
+uint32_t PostingIterator::frequency() const {
+    if (currentDoc == END) return 0;
+    return inPending ? pending[2 * position + 1] : frequencies[position];
+}
+
+bool PostingIterator::loadNextBlock() {
+    if (cursor >= end) {
+        return false;
+    }
+
+    uint32_t firstDoc = readUint32(cursor);
+    uint32_t payloadBytes = readUint32(cursor + 8);
+    blockCount = cursor[12];
+    readBounds(cursor);
+    const uint8_t* in = cursor + PostingList::HEADER_SIZE;
+
+    docIds[0] = firstDoc;
+    for (size_t i = 1; i < blockCount; ++i) {
+        uint32_t gap;
+        in = readVarint(in, gap);
+        docIds[i] = docIds[i - 1] + gap;
+    }
+    for (size_t i = 0; i < blockCount; ++i) {
+        in = readVarint(in, frequencies[i]);
+    }
+
+    cursor += PostingList::HEADER_SIZE + payloadBytes;
+    position = 0;
+    blockBase = nextBase;
+    nextBase += blockCount;
+    currentDoc = docIds[0];
+    return true;
+}
+
+void PostingIterator::loadPending() {
+    inPending = true;
+    position = 0;
+    blockBase = nextBase;
+    currentDoc = pendingCount > 0 ? pending[0] : END;
+    readPendingBounds();
+}
+
+void PostingIterator::readPendingBounds() {
+    // The unencoded tail keeps no lengths, so 0 stands in as the bound
+    boundLastDoc = pendingCount > 0 ? pending[2 * (pendingCount - 1)] : END;
+    boundMaxFrequency = 0;
+    boundMinLength = 0;
+    for (size_t i = 0; i < pendingCount; ++i) {
+        boundMaxFrequency = std::max(boundMaxFrequency, pending[2 * i + 1]);
+    }
+}
+
+void PostingIterator::readBounds(const uint8_t* header) {
+    boundLastDoc = readUint32(header + 4);
+    boundMaxFrequency = readUint32(header + 13);
+    boundMinLength = readUint32(header + 17);
+}
+
+uint32_t PostingIterator::next() {
+    if (currentDoc == END) return END;
+
+    position++;
+    if (inPending) {
+        currentDoc = position < pendingCount ? pending[2 * position] : END;
+    } else if (position < blockCount) {
+        currentDoc = docIds[position];
+    } else if (!loadNextBlock()) {
+        loadPending();
+    }
+    return currentDoc;
+}
+
+uint32_t PostingIterator::advance(uint32_t target) {
+    if (currentDoc == END || currentDoc >= target) return currentDoc;
+
+    if (!inPending && docIds[blockCount - 1] < target) {
+        // Hop over whole blocks whose lastDocId is still below the target
+        while (cursor < end && readUint32(cursor + 4) < target) {
+            nextBase += cursor[12];
+            cursor += PostingList::HEADER_SIZE + readUint32(cursor + 8);
+        }
+        if (!loadNextBlock()) {
+            loadPending();
+        }
+        if (currentDoc >= target) return currentDoc;
+    }
+
+    // Gallop to the target within the decoded block or the pending tail
+    if (inPending) {
+        position = gallop(pending, 2, position, pendingCount, target);
+        currentDoc = position < pendingCount ? pending[2 * position] : END;
+    } else {
+        position = gallop(docIds, 1, position, blockCount, target);
+        currentDoc = docIds[position];
+    }
+    return currentDoc;
+}
+
+void PostingIterator::shallowAdvance(uint32_t target) {
+    if (currentDoc == END || boundLastDoc >= target) return;
+
+    if (!inPending) {
+        // Hop headers without decoding; cursor stays on the next block to load
+        while (cursor < end && readUint32(cursor + 4) < target) {
+            nextBase += cursor[12];
+            cursor += PostingList::HEADER_SIZE + readUint32(cursor + 8);
+        }
+        if (cursor < end) {
+            readBounds(cursor);
+            return;
+        }
+        if (pendingCount > 0 && pending[2 * (pendingCount - 1)] >= target) {
+            readPendingBounds();
+            return;
+        }
+    }
+
+    boundLastDoc = END;
+    boundMaxFrequency = 0;
+    boundMinLength = 0;
+}
@@ -0,0 +1,62 @@
+#include "ProximityMatcher.h"
+
+ProximityMatcher::ProximityMatcher(const ProximityClause& clause,
+                                   const std::vector<PostingListView>& postings)
+    : kind(clause.kind), distance(clause.distance), lists(postings), positions(postings.size()) {
+    for (const auto& list : lists) {
+        iterators.push_back(list.iterator());
+    }
+}
+
+bool ProximityMatcher::matches(uint32_t docId) {
+    for (size_t i = 0; i < iterators.size(); ++i) {
+        if (iterators[i].advance(docId) != docId) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < iterators.size(); ++i) {
+        lists[i].positions(iterators[i].ordinal(), positions[i]);
+    }
+    return kind == ProximityClause::Kind::PHRASE ? matchPhrase() : matchNear();
+}
+
+bool ProximityMatcher::matchPhrase() {
+    // Keep the start positions p of the first term for which term i occurs
+    // at p + i, merging two sorted lists per term
+    starts = positions[0];
+    for (size_t i = 1; i < positions.size() && !starts.empty(); ++i) {
+        const std::vector<uint32_t>& next = positions[i];
+        size_t kept = 0;
+        size_t j = 0;
+        for (uint32_t start : starts) {
+            while (j < next.size() && next[j] < start + i) {
+                j++;
+            }
+            if (j < next.size() && next[j] == start + i) {
+                starts[kept++] = start;
+            }
+        }
+        starts.resize(kept);
+    }
+    return !starts.empty();
+}
+
+bool ProximityMatcher::matchNear() const {
+    // Walk both sorted lists, always moving the one that is behind
+    const std::vector<uint32_t>& a = positions[0];
+    const std::vector<uint32_t>& b = positions[1];
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        uint32_t gap = a[i] < b[j] ? b[j] - a[i] : a[i] - b[j];
+        if (gap <= distance) {
+            return true;
+        }
+        if (a[i] < b[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return false;
+}
@@ -2,34 +2,63 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <cstdlib>
+#include <limits>
 #include "Stemmer.h"
+#include "Tokenizer.h"
+#include "LevenshteinAutomaton.h"
+#include "WildcardPattern.h"
 
-QueryProcessor::QueryProcessor(IndexHandler* indexHandler) 
+QueryProcessor::QueryProcessor(const IndexHandler* indexHandler) 
     : indexHandler(indexHandler) {}
 
-std::vector<std::shared_ptr<Document>> QueryProcessor::processQuery(const std::string& queryString) {
-    // Clear previous query components
-    clearQueryComponents();
+std::vector<std::shared_ptr<Document>> QueryProcessor::processQuery(const std::string& queryString) const {
+    QueryPlan plan = parse(queryString);
 
-    // Parse the query
-    parseQuery(queryString);
+    if (!plan.proximities.empty() && !indexHandler->hasPositions()) {
+        std::cout << "Note: this index has no positions (build it with --positions), "
+                  << "so phrases and NEAR match their words anywhere.\n";
+    }
 
-    // Get and return results
-    auto results = indexHandler->getRelevantDocuments(terms, excludedTerms, organizations, persons);
+    // Fetch and display one page at a time
+    std::vector<std::shared_ptr<Document>> firstPage;
+    size_t offset = 0;
+    while (true) {
+        SearchResults page = search(plan, PAGE_SIZE, offset);
+        if (offset == 0) {
+            firstPage = page.documents;
+            if (page.truncatedExpansion) {
+                std::cout << "Note: a wildcard or fuzzy term matched too many terms; "
+                          << "only some of them were searched.\n";
+            }
+        }
+        if (!displayResults(page, offset)) {
+            break;
+        }
+        offset += PAGE_SIZE;
+    }
 
-    // Display results
-    displayResults(results);
+    return firstPage;
+}
 
-    return results;
+SearchResults QueryProcessor::search(const QueryPlan& plan, size_t limit, size_t offset) const {
+    return indexHandler->getTopDocuments(plan, limit, offset);
 }
 
-void QueryProcessor::parseQuery(const std::string& queryString) {
+SearchResults QueryProcessor::search(const std::string& queryString, size_t limit, size_t offset) const {
+    return search(parse(queryString), limit, offset);
+}
+
+QueryPlan QueryProcessor::parse(const std::string& queryString) const {
+    QueryPlan plan;
     std::istringstream iss(queryString);
     std::string token;
     std::string currentOrg;
     std::string currentPerson;
     bool readingOrg = false;
     bool readingPerson = false;
+    bool readingNear = false;  // the next term must be near the previous one
+    uint32_t nearDistance = 0;
 
     while (iss >> token) {
         if (token.substr(0, 4) == "ORG:") {
@@ -45,7 +74,7 @@ void QueryProcessor::parseQuery(const std::string& queryString) {
         else if (token[0] == '-') {
             readingOrg = false;
             readingPerson = false;
-            excludedTerms.push_back(stemmer.stemWord(token.substr(1)));
+            plan.excludedTerms.push_back(queryTerm(token.substr(1)));
         }
         else if (readingOrg) {
             currentOrg += " " + token;
@@ -53,64 +82,164 @@ void QueryProcessor::parseQuery(const std::string& queryString) {
         else if (readingPerson) {
             currentPerson += " " + token;
         }
+        else if (token == "OR") {
+            // Any term may match instead of all of them
+            plan.matchMode = MatchMode::ANY;
+        }
+        else if (token.substr(0, 5) == "NEAR/" && !plan.terms.empty()) {
+            readingNear = true;
+            nearDistance = static_cast<uint32_t>(std::strtoul(token.c_str() + 5, nullptr, 10));
+        }
+        else if (token[0] == '"') {
+            // Quoted phrase, possibly spanning several tokens
+            std::string phrase = token.substr(1);
+            std::string more;
+            while ((phrase.empty() || phrase.back() != '"') && iss >> more) {
+                phrase += " " + more;
+            }
+            if (!phrase.empty() && phrase.back() == '"') {
+                phrase.pop_back();
+            }
+            addPhrase(phrase, plan);
+        }
         else {
-            terms.push_back(stemmer.stemWord(token));
+            std::string term = queryTerm(token);
+            // Expanded terms carry no positions, so NEAR only pairs plain ones
+            if (readingNear && !isExpanded(term) && !isExpanded(plan.terms.back())) {
+                ProximityClause clause;
+                clause.kind = ProximityClause::Kind::NEAR;
+                clause.terms = {plan.terms.back(), term};
+                clause.distance = nearDistance;
+                plan.proximities.push_back(clause);
+            }
+            readingNear = false;
+            plan.terms.push_back(term);
         }
     }
 
     if (readingOrg && !currentOrg.empty()) {
-        organizations.push_back(currentOrg);
+        plan.organizations.push_back(currentOrg);
     }
     if (readingPerson && !currentPerson.empty()) {
-        persons.push_back(currentPerson);
+        plan.persons.push_back(currentPerson);
     }
+    return plan;
 }
 
-void QueryProcessor::displayResults(const std::vector<std::shared_ptr<Document>>& results) {
-    if (results.empty()) {
+void QueryProcessor::addPhrase(const std::string& phrase, QueryPlan& plan) const {
+    // Split and normalize exactly as document text is, so positions line up
+    std::vector<char> buffer(phrase.begin(), phrase.end());
+    std::vector<std::string_view> words;
+    Tokenizer::tokenize(buffer.data(), buffer.size(), words);
+
+    // Positions were counted without the index's stopwords, so the same
+    // words must go here for the gaps to match
+    StopWords stopWords = indexHandler->stopWords();
+    ProximityClause clause;
+    clause.kind = ProximityClause::Kind::PHRASE;
+    for (std::string_view word : words) {
+        if (stopWords.isStopWord(word)) {
+            continue;
+        }
+        std::string stemmed(word);
+        stemmed.resize(stemmer.stem(&stemmed[0], stemmed.size()));
+        if (!stemmed.empty()) {
+            clause.terms.push_back(stemmed);
+        }
+    }
+
+    plan.terms.insert(plan.terms.end(), clause.terms.begin(), clause.terms.end());
+    if (clause.terms.size() > 1) {
+        plan.proximities.push_back(clause);
+    }
+}
+
+std::string QueryProcessor::queryTerm(const std::string& token) const {
+    if (WildcardPattern::isPattern(token)) {
+        return WildcardPattern::normalize(token);
+    }
+    std::string word;
+    uint32_t maxDistance;
+    if (LevenshteinAutomaton::parse(token, word, maxDistance)) {
+        return stemmer.stemWord(word) + "~" + std::to_string(maxDistance);
+    }
+    return stemmer.stemWord(token);
+}
+
+bool QueryProcessor::isExpanded(const std::string& term) {
+    std::string word;
+    uint32_t maxDistance;
+    return WildcardPattern::isPattern(term) || LevenshteinAutomaton::parse(term, word, maxDistance);
+}
+
+bool QueryProcessor::displayResults(const SearchResults& results, size_t offset) const {
+    if (results.documents.empty()) {
         std::cout << "No results found.\n";
-        return;
+        return false;
     }
 
-    std::cout << "\nFound " << results.size() << " results:\n";
+    // With pruning the total is only known to be at least this many
+    std::string total = std::to_string(results.totalMatches) + (results.exactTotal ? "" : "+");
+    if (offset == 0) {
+        std::cout << "\nFound " << total << " results:\n";
+    } else {
+        std::cout << "\nResults " << offset + 1 << "-" << offset + results.documents.size()
+                  << " of " << total << ":\n";
+    }
     std::cout << "----------------------------------------\n";
 
-    // Display up to 15 results
-    int count = 0;
-    for (const auto& doc : results) {
-        if (count >= 15) break;
-
-        std::cout << count + 1 << ". " << doc->getTitle() << "\n";
+    // Results are numbered across pages
+    size_t number = offset;
+    for (const auto& doc : results.documents) {
+        std::cout << ++number << ". " << doc->getTitle() << "\n";
         std::cout << "   Publication: " << doc->getPublication() << "\n";
         std::cout << "   Date: " << doc->getDatePublished() << "\n";
         std::cout << "----------------------------------------\n";
-        count++;
     }
+    bool hasNextPage = !results.exactTotal || number < results.totalMatches;
 
-    // Prompt user to view full document
-    std::cout << "\nEnter a number to view the full document (0 to continue): ";
-    int choice;
+    // Prompt user to view full document or the next page
+    std::cout << "\nEnter a number to view the full document";
+    if (hasNextPage) {
+        std::cout << ", n for the next page";
+    }
+    std::cout << " (0 to continue): ";
+    std::string input;
     
     // Handle invalid input
-    if (!(std::cin >> choice)) {
+    if (!(std::cin >> input)) {
         std::cin.clear();  // Clear error flags
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');  // Clear input buffer
-        return;
+        return false;
     }
 
     // Clear any remaining characters in the input buffer
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
+    if (input == "n" || input == "N") {
+        return hasNextPage;
+    }
+
+    size_t choice;
+    std::istringstream choiceStream(input);
+    if (!(choiceStream >> choice)) {
+        return false;
+    }
+
     // Validate choice range
-    if (choice > 0 && choice <= count) {
-        displayDocument(results[choice - 1]);
+    if (choice > offset && choice <= number) {
+        displayDocument(results.documents[choice - offset - 1]);
     } else if (choice != 0) {
         std::cout << "Invalid selection.\n";
     }
+    return false;
 }
 
-void QueryProcessor::displayDocument(const std::shared_ptr<Document>& doc) {
-    if (!doc) return;  // Safety check
+void QueryProcessor::displayDocument(const std::shared_ptr<Document>& result) const {
+    if (!result) return;  // Safety check
+
+    // Results only carry metadata; fetch the body from the document store
+    auto doc = indexHandler->loadDocument(result->getDocId());
+    if (!doc) return;
 
     std::cout << "\n========================================\n";
     std::cout << "Title: " << doc->getTitle() << "\n";
@@ -143,10 +272,3 @@ void QueryProcessor::displayDocument(const std::shared_ptr<Document>& doc) {
     std::cout << "\nPress Enter to continue...";
     std::cin.get();
 }
-
-void QueryProcessor::clearQueryComponents() {
-    terms.clear();
-    excludedTerms.clear();
-    organizations.clear();
-    persons.clear();
-} 
\ No newline at end of file
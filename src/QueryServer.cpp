@@ -0,0 +1,348 @@
+#include "QueryServer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "BoundedQueue.h"
+
+namespace {
+
+// Accepted connections waiting per worker before accept blocks
+constexpr size_t QUEUE_PER_THREAD = 4;
+
+std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+        return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    });
+    return text;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode a query string component: "+" is a space, "%xx" a byte
+std::string urlDecode(const std::string& text) {
+    std::string result;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            result += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0 &&
+                   hexValue(text[i + 2]) >= 0) {
+            result += static_cast<char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+            i += 2;
+        } else {
+            result += text[i];
+        }
+    }
+    return result;
+}
+
+// Value of name in a "a=1&b=2" query string; false if it is absent
+bool queryParameter(const std::string& query, const std::string& name, std::string& value) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        size_t equals = query.find('=', start);
+        if (equals < end && query.compare(start, equals - start, name) == 0 &&
+            equals - start == name.size()) {
+            value = urlDecode(query.substr(equals + 1, end - equals - 1));
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+// Non-negative integer parameter; false if present but malformed
+bool numberParameter(const std::string& query, const std::string& name, size_t& value) {
+    std::string text;
+    if (!queryParameter(query, name, text)) {
+        return true;
+    }
+    if (text.empty() || text.size() > 9 ||
+        !std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    value = std::stoul(text);
+    return true;
+}
+
+void appendJsonString(std::string& out, const std::string& text) {
+    static const char* HEX = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0xF];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+std::string errorBody(const std::string& message) {
+    std::string body = "{\"error\": ";
+    appendJsonString(body, message);
+    body += "}";
+    return body;
+}
+
+const char* statusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        default: return "Internal Server Error";
+    }
+}
+
+// Write all of data; false if the peer went away
+bool sendAll(int socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = ::send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+std::string httpResponse(int status, const std::string& body, bool keepAlive) {
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n";
+    response += "Content-Type: application/json\r\n";
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    response += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    response += body;
+    return response;
+}
+
+} // namespace
+
+QueryServer::QueryServer(const IndexHandler* indexHandler, size_t threadCount)
+    : processor(indexHandler), threadCount(threadCount), listenSocket(-1), stopping(false) {
+    if (this->threadCount == 0) {
+        this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void QueryServer::serve(uint16_t port) {
+    int server = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (server < 0) {
+        throw std::runtime_error(std::string("Cannot create socket: ") + std::strerror(errno));
+    }
+    int reuse = 1;
+    ::setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(server, SOMAXCONN) < 0) {
+        std::string reason = std::strerror(errno);
+        ::close(server);
+        throw std::runtime_error("Cannot listen on port " + std::to_string(port) + ": " + reason);
+    }
+    listenSocket = server;
+    if (stopping) {
+        ::shutdown(server, SHUT_RDWR);
+    }
+
+    BoundedQueue<int> connections(threadCount * QUEUE_PER_THREAD);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this, &connections] {
+            int client;
+            while (connections.pop(client)) {
+                handleConnection(client);
+                ::close(client);
+            }
+        });
+    }
+
+    while (!stopping) {
+        int client = ::accept(server, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (stopping) break;
+            // Out of descriptors or similar; back off instead of spinning
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        // Idle keep-alive connections must not hold a worker forever
+        timeval timeout{};
+        timeout.tv_sec = IDLE_TIMEOUT_SECONDS;
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (!connections.push(client)) {
+            ::close(client);
+        }
+    }
+
+    connections.close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    listenSocket = -1;
+    ::close(server);
+}
+
+void QueryServer::stop() {
+    // Only async-signal-safe calls, so this may run in a signal handler
+    stopping = true;
+    int server = listenSocket;
+    if (server >= 0) {
+        ::shutdown(server, SHUT_RDWR);
+    }
+}
+
+void QueryServer::handleConnection(int client) const {
+    std::string buffer;
+    char chunk[4096];
+    while (!stopping) {
+        // Read up to the end of the request head; bodies are not used
+        size_t headEnd;
+        while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (buffer.size() > MAX_REQUEST_BYTES) {
+                sendAll(client, httpResponse(431, errorBody("Request too large"), false));
+                return;
+            }
+            ssize_t received = ::recv(client, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0) return;  // closed, failed or idle too long
+            buffer.append(chunk, static_cast<size_t>(received));
+        }
+        std::string head = buffer.substr(0, headEnd);
+        buffer.erase(0, headEnd + 4);
+
+        // Request line: method, target and version
+        size_t lineEnd = head.find("\r\n");
+        std::string requestLine = head.substr(0, lineEnd);
+        size_t firstSpace = requestLine.find(' ');
+        size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+        if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+            sendAll(client, httpResponse(400, errorBody("Malformed request line"), false));
+            return;
+        }
+        std::string method = requestLine.substr(0, firstSpace);
+        std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+        std::string version = requestLine.substr(secondSpace + 1);
+
+        // HTTP/1.1 keeps the connection open unless asked not to, 1.0 only
+        // if asked to
+        std::string headers = toLower(lineEnd == std::string::npos ? "" : head.substr(lineEnd));
+        bool keepAlive = version == "HTTP/1.1"
+            ? headers.find("\r\nconnection: close") == std::string::npos
+            : headers.find("\r\nconnection: keep-alive") != std::string::npos;
+        // A request body would be read as the next request
+        if (headers.find("\r\ncontent-length:") != std::string::npos ||
+            headers.find("\r\ntransfer-encoding:") != std::string::npos) {
+            keepAlive = false;
+        }
+
+        int status;
+        std::string body = respond(method, target, status);
+        if (!sendAll(client, httpResponse(status, body, keepAlive)) || !keepAlive) {
+            return;
+        }
+    }
+}
+
+std::string QueryServer::respond(const std::string& method, const std::string& target,
+                                 int& status) const {
+    if (method != "GET") {
+        status = 405;
+        return errorBody("Only GET is supported");
+    }
+
+    size_t question = target.find('?');
+    std::string path = target.substr(0, question);
+    std::string query = question == std::string::npos ? "" : target.substr(question + 1);
+    if (path != "/search") {
+        status = 404;
+        return errorBody("Unknown path; use /search?q=<query>");
+    }
+
+    std::string queryString;
+    size_t count = DEFAULT_RESULTS;
+    size_t offset = 0;
+    if (!queryParameter(query, "q", queryString)) {
+        status = 400;
+        return errorBody("Missing query parameter q");
+    }
+    if (!numberParameter(query, "k", count) || !numberParameter(query, "offset", offset)) {
+        status = 400;
+        return errorBody("k and offset must be non-negative integers");
+    }
+    count = std::min(count, MAX_RESULTS);
+    if (offset + count > MAX_PAGE_DEPTH) {
+        status = 400;
+        return errorBody("offset + k must not exceed " + std::to_string(MAX_PAGE_DEPTH));
+    }
+
+    SearchResults results;
+    try {
+        results = processor.search(queryString, count, offset);
+    } catch (const std::exception& e) {
+        status = 500;
+        return errorBody(e.what());
+    }
+
+    std::string body = "{\"query\": ";
+    appendJsonString(body, queryString);
+    body += ", \"total\": " + std::to_string(results.totalMatches);
+    body += ", \"exactTotal\": ";
+    body += results.exactTotal ? "true" : "false";
+    body += ", \"truncatedExpansion\": ";
+    body += results.truncatedExpansion ? "true" : "false";
+    body += ", \"hits\": [";
+    size_t rank = offset;
+    for (const auto& doc : results.documents) {
+        if (rank > offset) {
+            body += ", ";
+        }
+        body += "{\"rank\": " + std::to_string(++rank);
+        body += ", \"docId\": " + std::to_string(doc->getDocId());
+        body += ", \"title\": ";
+        appendJsonString(body, doc->getTitle());
+        body += ", \"publication\": ";
+        appendJsonString(body, doc->getPublication());
+        body += ", \"date\": ";
+        appendJsonString(body, doc->getDatePublished());
+        body += ", \"path\": ";
+        appendJsonString(body, doc->getFilePath());
+        body += "}";
+    }
+    body += "]}";
+    status = 200;
+    return body;
+}
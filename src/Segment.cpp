@@ -0,0 +1,323 @@
+#include "Segment.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+Segment::Segment() : base(0), end(0), totalLength(0), positions(false) {}
+
+std::shared_ptr<const Segment> Segment::open(const std::string& filePath,
+                                             std::shared_ptr<const DocumentStore> store) {
+    std::shared_ptr<Segment> segment(new Segment());
+    if (!segment->file.open(filePath)) {
+        throw std::runtime_error("Cannot open index file " + filePath);
+    }
+    if (store->size() != segment->file.documentCount()) {
+        throw std::runtime_error("Document store does not match index file " + filePath);
+    }
+    segment->store = std::move(store);
+    segment->end = segment->file.documentCount();
+    segment->totalLength = segment->file.totalDocumentLength();
+    segment->positions = segment->file.hasPositions(IndexField::TERMS);
+    return segment;
+}
+
+std::shared_ptr<const Segment> Segment::merge(const std::vector<std::shared_ptr<const Segment>>& segments,
+                                              const std::vector<std::shared_ptr<const DeletedDocs>>& deletions,
+                                              MergeThrottle* throttle) {
+    std::shared_ptr<Segment> merged(new Segment());
+    if (!segments.empty()) {
+        merged->base = segments.front()->base;
+        merged->end = segments.back()->end;
+    }
+    merged->positions = !segments.empty() &&
+        std::all_of(segments.begin(), segments.end(), [](const auto& s) { return s->positions; });
+    merged->removed = DeletedDocs(merged->base, merged->end);
+    auto deletedFrom = [&deletions](size_t s) { return s < deletions.size() ? deletions[s].get() : nullptr; };
+
+    for (size_t s = 0; s < segments.size(); ++s) {
+        const Segment* segment = segments[s].get();
+        const DeletedDocs* deleted = deletedFrom(s);
+        for (uint32_t docId = segment->base; docId < segment->end; ++docId) {
+            if (segment->isRemoved(docId) || (deleted && deleted->contains(docId))) {
+                // The docId stays taken, by a document with nothing left
+                merged->removed.add(docId);
+                merged->lengths.push_back(0);
+                merged->summaries.emplace_back();
+                continue;
+            }
+            uint32_t length = segment->documentLength(docId);
+            merged->lengths.push_back(length);
+            merged->totalLength += length;
+            auto doc = segment->loadSummary(docId);
+            merged->summaries.push_back({doc->getFilePath(), doc->getTitle(),
+                                         doc->getPublication(), doc->getDatePublished()});
+            const Summary& summary = merged->summaries.back();
+            if (throttle && !throttle->pace(sizeof(length) + summary.filePath.size() + summary.title.size() +
+                                            summary.publication.size() + summary.datePublished.size())) {
+                return nullptr;
+            }
+        }
+    }
+
+    // Merge the sorted dictionaries field by field. Posting lists hold
+    // global docIds, so a key's lists are appended segment by segment with
+    // their encoded blocks copied rather than decoded.
+    for (size_t i = 0; i < INDEX_FIELD_COUNT; ++i) {
+        IndexField field = static_cast<IndexField>(i);
+        bool copyPositions = merged->positions && field == IndexField::TERMS;
+        std::vector<TermDictionary::Cursor> cursors;
+        for (const auto& segment : segments) {
+            cursors.push_back(segment->dictionary(field).cursor());
+        }
+
+        Field& target = merged->fields[i];
+        TermDictionaryBuilder keys;
+        while (true) {
+            // Smallest key not merged yet; few segments, so a linear scan
+            const TermDictionary::Cursor* smallest = nullptr;
+            for (const auto& cursor : cursors) {
+                if (cursor.valid() && (!smallest || cursor.key() < smallest->key())) {
+                    smallest = &cursor;
+                }
+            }
+            if (!smallest) break;
+            std::string key(smallest->key());
+
+            PostingList postings;
+            size_t bytes = 0;
+            for (size_t s = 0; s < segments.size(); ++s) {
+                if (!cursors[s].valid() || cursors[s].key() != key) continue;
+                PostingListView view = segments[s]->postingsAt(field, cursors[s].ordinal());
+                postings.appendList(view, copyPositions, deletedFrom(s));
+                bytes += view.size + (copyPositions ? view.positionSize : 0);
+                cursors[s].next();
+            }
+            postings.seal();
+            if (!postings.empty()) {
+                keys.add(key);
+                target.postings.push_back(std::move(postings));
+            }
+            if (throttle && !throttle->pace(key.size() + bytes)) {
+                return nullptr;
+            }
+        }
+        buildField(target, keys);
+    }
+    return merged;
+}
+
+std::shared_ptr<const Segment> Segment::compact(const Segment& segment) {
+    std::shared_ptr<Segment> compacted(new Segment());
+    compacted->positions = segment.positions;
+
+    // New docId of each live document, by old docId
+    std::vector<uint32_t> docIds(segment.documentCount(), 0);
+    for (uint32_t docId = segment.base; docId < segment.end; ++docId) {
+        if (segment.isRemoved(docId)) continue;
+        docIds[docId - segment.base] = compacted->end++;
+        uint32_t length = segment.documentLength(docId);
+        compacted->lengths.push_back(length);
+        compacted->totalLength += length;
+        auto doc = segment.loadSummary(docId);
+        compacted->summaries.push_back({doc->getFilePath(), doc->getTitle(),
+                                        doc->getPublication(), doc->getDatePublished()});
+    }
+    compacted->removed = DeletedDocs(0, compacted->end);
+
+    std::vector<uint32_t> positions;
+    for (size_t i = 0; i < INDEX_FIELD_COUNT; ++i) {
+        IndexField field = static_cast<IndexField>(i);
+        bool copyPositions = compacted->positions && field == IndexField::TERMS;
+        Field& target = compacted->fields[i];
+        TermDictionaryBuilder keys;
+        for (auto cursor = segment.dictionary(field).cursor(); cursor.valid(); cursor.next()) {
+            PostingListView view = segment.postingsAt(field, cursor.ordinal());
+            PostingList postings;
+            for (auto it = view.iterator(); it.docId() != PostingIterator::END; it.next()) {
+                if (segment.isRemoved(it.docId())) continue;
+                uint32_t docId = docIds[it.docId() - segment.base];
+                postings.append(docId, it.frequency(), compacted->lengths[docId]);
+                if (copyPositions && view.positions(it.ordinal(), positions)) {
+                    for (uint32_t position : positions) {
+                        postings.addPosition(position);
+                    }
+                }
+            }
+            postings.seal();
+            if (!postings.empty()) {
+                keys.add(cursor.key());
+                target.postings.push_back(std::move(postings));
+            }
+        }
+        buildField(target, keys);
+    }
+    return compacted;
+}
+
+void Segment::buildField(Field& field, TermDictionaryBuilder& keys) {
+    field.keys = TermDictionary(keys.finish());
+    field.suffixes = SuffixIndex(SuffixIndex::build(field.keys));
+}
+
+uint32_t Segment::documentLength(uint32_t docId) const {
+    return file.isOpen() ? file.documentLength(docId) : lengths[docId - base];
+}
+
+bool Segment::isRemoved(uint32_t docId) const {
+    return file.isOpen() ? file.isRemoved(docId) : removed.contains(docId);
+}
+
+size_t Segment::removedCount() const {
+    return file.isOpen() ? file.removedCount() : removed.size();
+}
+
+const TermDictionary& Segment::dictionary(IndexField field) const {
+    return file.isOpen() ? file.dictionary(field) : fields[static_cast<size_t>(field)].keys;
+}
+
+const SuffixIndex& Segment::suffixes(IndexField field) const {
+    return file.isOpen() ? file.suffixes(field) : fields[static_cast<size_t>(field)].suffixes;
+}
+
+PostingListView Segment::postingsAt(IndexField field, size_t ordinal) const {
+    return file.isOpen() ? file.postingsAt(field, ordinal)
+                         : fields[static_cast<size_t>(field)].postings[ordinal].view();
+}
+
+PostingListView Segment::find(IndexField field, std::string_view key) const {
+    if (file.isOpen()) {
+        return file.find(field, key);
+    }
+    size_t ordinal = dictionary(field).find(key);
+    return ordinal == TermDictionary::NOT_FOUND ? PostingListView() : postingsAt(field, ordinal);
+}
+
+std::shared_ptr<Document> Segment::loadSummary(uint32_t docId) const {
+    if (docId < base || docId >= end || isRemoved(docId)) {
+        return nullptr;
+    }
+    if (file.isOpen()) {
+        return store->loadSummary(docId);
+    }
+
+    const Summary& summary = summaries[docId - base];
+    auto doc = std::make_shared<Document>(summary.filePath);
+    doc->setTitle(summary.title);
+    doc->setPublication(summary.publication);
+    doc->setDatePublished(summary.datePublished);
+    doc->setDocId(docId);
+    return doc;
+}
+
+bool Segment::write(const std::string& filePath) const {
+    IndexFileWriter writer;
+    if (base != 0 || !writer.open(filePath)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < INDEX_FIELD_COUNT; ++i) {
+        IndexField field = static_cast<IndexField>(i);
+        for (auto it = dictionary(field).cursor(); it.valid(); it.next()) {
+            writer.addKey(field, it.key(), postingsAt(field, it.ordinal()));
+        }
+    }
+
+    std::vector<uint32_t> documentLengths;
+    documentLengths.reserve(documentCount());
+    DeletedDocs removedDocuments(base, end);
+    for (uint32_t docId = base; docId < end; ++docId) {
+        documentLengths.push_back(documentLength(docId));
+        if (isRemoved(docId)) {
+            removedDocuments.add(docId);
+        }
+    }
+    return writer.finish(documentLengths, removedDocuments);
+}
+
+SegmentBuilder::SegmentBuilder(uint32_t baseDocId, bool storePositions)
+    : base(baseDocId), storePositions(storePositions), totalLength(0) {}
+
+void SegmentBuilder::add(uint32_t docId, const Document& doc) {
+    uint32_t length = static_cast<uint32_t>(doc.getTerms().size());
+    lengths.push_back(length);
+    totalLength += length;
+    summaries.push_back({doc.getFilePath(), doc.getTitle(), doc.getPublication(), doc.getDatePublished()});
+
+    // Index the processed terms straight from the parser's token buffer
+    const auto& terms = doc.getTerms();
+    for (size_t position = 0; position < terms.size(); ++position) {
+        PostingList& postings = termIndex.upsert(terms[position]);
+        postings.add(docId, length);
+        if (storePositions) {
+            postings.addPosition(static_cast<uint32_t>(position));
+        }
+    }
+
+    // Index organizations
+    for (const auto& org : doc.getOrganizations()) {
+        addToIndex(org, docId, length, orgIndex);
+    }
+
+    // Index persons
+    for (const auto& person : doc.getPersons()) {
+        addToIndex(person, docId, length, personIndex);
+    }
+}
+
+void SegmentBuilder::addToIndex(const std::string& key,
+                                uint32_t docId,
+                                uint32_t length,
+                                AVLTree<std::string, PostingList>& index) {
+    // Documents are indexed one at a time with increasing docIds, so the
+    // posting list only ever appends or bumps the frequency of its last entry
+    index.upsert(key).add(docId, length);
+}
+
+AVLTree<std::string, PostingList>& SegmentBuilder::treeFor(IndexField field) {
+    if (field == IndexField::ORGANIZATIONS) {
+        return orgIndex;
+    }
+    return field == IndexField::PERSONS ? personIndex : termIndex;
+}
+
+std::shared_ptr<const Segment> SegmentBuilder::build() {
+    std::shared_ptr<Segment> segment(new Segment());
+    segment->base = base;
+    segment->end = base + static_cast<uint32_t>(lengths.size());
+    segment->totalLength = totalLength;
+    segment->positions = storePositions;
+    segment->removed = DeletedDocs(segment->base, segment->end);
+
+    for (size_t i = 0; i < INDEX_FIELD_COUNT; ++i) {
+        AVLTree<std::string, PostingList>& tree = treeFor(static_cast<IndexField>(i));
+        Segment::Field& field = segment->fields[i];
+        TermDictionaryBuilder keys;
+        field.postings.reserve(tree.size());
+        tree.forEach([&](const std::string& key, PostingList& postings) {
+            postings.seal();
+            keys.add(key);
+            field.postings.push_back(std::move(postings));
+        });
+        Segment::buildField(field, keys);
+        tree.clear();
+    }
+    segment->lengths = std::move(lengths);
+    segment->summaries = std::move(summaries);
+
+    base = segment->end;
+    lengths.clear();
+    summaries.clear();
+    totalLength = 0;
+    return segment;
+}
+
+void SegmentBuilder::reset(uint32_t baseDocId, bool storePositions) {
+    termIndex.clear();
+    orgIndex.clear();
+    personIndex.clear();
+    lengths.clear();
+    summaries.clear();
+    totalLength = 0;
+    base = baseDocId;
+    this->storePositions = storePositions;
+}
@@ -1,160 +1,147 @@
 #include "Stemmer.h"
 #include <algorithm>
-#include <string>
+#include <cstring>
 
-// Add custom ends_with helper function
-bool ends_with(const std::string& str, const std::string& suffix) {
-    if (str.length() < suffix.length()) return false;
-    return str.compare(str.length() - suffix.length(), suffix.length(), suffix) == 0;
+namespace {
+
+bool endsWith(const char* word, size_t length, const char* suffix, size_t suffixLength) {
+    return length >= suffixLength &&
+           std::memcmp(word + length - suffixLength, suffix, suffixLength) == 0;
+}
+
+// Replace the last oldLength characters with newEnd (never longer) and
+// return the new length
+size_t replaceEnding(char* word, size_t length, size_t oldLength, const char* newEnd, size_t newLength) {
+    std::memcpy(word + length - oldLength, newEnd, newLength);
+    return length - oldLength + newLength;
+}
+
+bool isVowelLetter(char c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u';
 }
 
-std::string Stemmer::stemWord(const std::string& word) {
+// Consonant status of word[i] given the status of word[i - 1]: 'y' is a
+// consonant at the start of a word or after a vowel
+bool isConsonant(char c, size_t i, bool previousIsConsonant) {
+    if (isVowelLetter(c)) return false;
+    if (c == 'y') return i == 0 || !previousIsConsonant;
+    return true;
+}
+
+} // namespace
+
+#define SUFFIX(literal) literal, sizeof(literal) - 1
+
+std::string Stemmer::stemWord(const std::string& word) const {
     if (word.length() <= 2) return word;
     
     // Convert to lowercase
     std::string str = word;
     std::transform(str.begin(), str.end(), str.begin(), ::tolower);
     
-    // Apply Porter stemming steps
-    str = step1a(str);
-    str = step1b(str);
-    str = step1c(str);
-    str = step2(str);
-    str = step3(str);
-    str = step4(str);
-    str = step5(str);
-    
+    str.resize(stem(&str[0], str.length()));
     return str;
 }
 
-bool Stemmer::isConsonant(const std::string& str, int i) {
-    char c = str[i];
-    if (c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u') return false;
-    if (c == 'y') {
-        return (i == 0) ? true : !isConsonant(str, i - 1);
-    }
-    return true;
+size_t Stemmer::stem(char* word, size_t length) const {
+    if (length <= 2) return length;
+
+    // Apply Porter stemming steps
+    length = step1a(word, length);
+    length = step1b(word, length);
+    length = step1c(word, length);
+    length = step2(word, length);
+    length = step3(word, length);
+    length = step4(word, length);
+    length = step5(word, length);
+    return length;
 }
 
-int Stemmer::countConsonantSequences(const std::string& str) {
+int Stemmer::countConsonantSequences(const char* word, size_t length) {
     int count = 0;
     bool inConsonant = false;
-    for (size_t i = 0; i < str.length(); i++) {
-        if (isConsonant(str, i)) {
-            if (!inConsonant) {
-                count++;
-                inConsonant = true;
-            }
-        } else {
-            inConsonant = false;
+    for (size_t i = 0; i < length; i++) {
+        bool consonant = isConsonant(word[i], i, inConsonant);
+        if (consonant && !inConsonant) {
+            count++;
         }
+        inConsonant = consonant;
     }
     return count;
 }
 
-bool Stemmer::containsVowel(const std::string& str) {
-    for (size_t i = 0; i < str.length(); i++) {
-        if (!isConsonant(str, i)) return true;
+bool Stemmer::containsVowel(const char* word, size_t length) {
+    bool consonant = false;
+    for (size_t i = 0; i < length; i++) {
+        consonant = isConsonant(word[i], i, consonant);
+        if (!consonant) return true;
     }
     return false;
 }
 
-bool Stemmer::endsWithDoubleConsonant(const std::string& str) {
-    if (str.length() < 2) return false;
-    return (isConsonant(str, str.length() - 1) && 
-            isConsonant(str, str.length() - 2) &&
-            str[str.length() - 1] == str[str.length() - 2]);
-}
-
-bool Stemmer::endsWithCVC(const std::string& str) {
-    if (str.length() < 3) return false;
-    
-    size_t last = str.length() - 1;
-    char last_char = str[last];
-    
-    return (isConsonant(str, last - 2) &&
-            !isConsonant(str, last - 1) &&
-            isConsonant(str, last) &&
-            last_char != 'w' && last_char != 'x' && last_char != 'y');
-}
-
-std::string Stemmer::replaceEnding(const std::string& str, 
-                                 const std::string& oldEnd, 
-                                 const std::string& newEnd) {
-    if (str.length() < oldEnd.length()) return str;
-    
-    std::string ending = str.substr(str.length() - oldEnd.length());
-    if (ending == oldEnd) {
-        return str.substr(0, str.length() - oldEnd.length()) + newEnd;
-    }
-    return str;
-}
-
 // Implementation of Porter algorithm steps
-std::string Stemmer::step1a(const std::string& str) {
-    if (ends_with(str, "sses")) return replaceEnding(str, "sses", "ss");
-    if (ends_with(str, "ies")) return replaceEnding(str, "ies", "i");
-    if (ends_with(str, "ss")) return str;
-    if (ends_with(str, "s")) return replaceEnding(str, "s", "");
-    return str;
+size_t Stemmer::step1a(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("sses"))) return replaceEnding(word, length, 4, SUFFIX("ss"));
+    if (endsWith(word, length, SUFFIX("ies"))) return replaceEnding(word, length, 3, SUFFIX("i"));
+    if (endsWith(word, length, SUFFIX("ss"))) return length;
+    if (endsWith(word, length, SUFFIX("s"))) return length - 1;
+    return length;
 }
 
-std::string Stemmer::step1b(const std::string& str) {
-    if (ends_with(str, "eed")) {
-        std::string stem = str.substr(0, str.length() - 3);
-        if (countConsonantSequences(stem) > 0)
-            return replaceEnding(str, "eed", "ee");
-        return str;
+size_t Stemmer::step1b(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("eed"))) {
+        if (countConsonantSequences(word, length - 3) > 0)
+            return length - 1;  // "eed" -> "ee"
+        return length;
     }
     
-    if (ends_with(str, "ed")) {
-        std::string stem = str.substr(0, str.length() - 2);
-        if (containsVowel(stem))
-            return replaceEnding(str, "ed", "");
+    if (endsWith(word, length, SUFFIX("ed"))) {
+        if (containsVowel(word, length - 2))
+            return length - 2;
     }
     
-    if (ends_with(str, "ing")) {
-        std::string stem = str.substr(0, str.length() - 3);
-        if (containsVowel(stem))
-            return replaceEnding(str, "ing", "");
+    if (endsWith(word, length, SUFFIX("ing"))) {
+        if (containsVowel(word, length - 3))
+            return length - 3;
     }
     
-    return str;
+    return length;
 }
 
-std::string Stemmer::step1c(const std::string& str) {
-    if (ends_with(str, "y") && containsVowel(str.substr(0, str.length() - 1))) {
-        return replaceEnding(str, "y", "i");
+size_t Stemmer::step1c(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("y")) && containsVowel(word, length - 1)) {
+        word[length - 1] = 'i';
     }
-    return str;
+    return length;
 }
 
-// Implement other steps similarly...
-std::string Stemmer::step2(const std::string& str) {
-    if (ends_with(str, "ational")) return replaceEnding(str, "ational", "ate");
-    if (ends_with(str, "tional")) return replaceEnding(str, "tional", "tion");
-    if (ends_with(str, "enci")) return replaceEnding(str, "enci", "ence");
-    if (ends_with(str, "anci")) return replaceEnding(str, "anci", "ance");
-    return str;
+size_t Stemmer::step2(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("ational"))) return replaceEnding(word, length, 7, SUFFIX("ate"));
+    if (endsWith(word, length, SUFFIX("tional"))) return replaceEnding(word, length, 6, SUFFIX("tion"));
+    if (endsWith(word, length, SUFFIX("enci"))) return replaceEnding(word, length, 4, SUFFIX("ence"));
+    if (endsWith(word, length, SUFFIX("anci"))) return replaceEnding(word, length, 4, SUFFIX("ance"));
+    return length;
 }
 
-std::string Stemmer::step3(const std::string& str) {
-    if (ends_with(str, "icate")) return replaceEnding(str, "icate", "ic");
-    if (ends_with(str, "ative")) return replaceEnding(str, "ative", "");
-    if (ends_with(str, "alize")) return replaceEnding(str, "alize", "al");
-    return str;
+size_t Stemmer::step3(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("icate"))) return replaceEnding(word, length, 5, SUFFIX("ic"));
+    if (endsWith(word, length, SUFFIX("ative"))) return length - 5;
+    if (endsWith(word, length, SUFFIX("alize"))) return replaceEnding(word, length, 5, SUFFIX("al"));
+    return length;
 }
 
-std::string Stemmer::step4(const std::string& str) {
-    if (ends_with(str, "ment")) return replaceEnding(str, "ment", "");
-    if (ends_with(str, "ness")) return replaceEnding(str, "ness", "");
-    if (ends_with(str, "tion")) return replaceEnding(str, "tion", "t");
-    return str;
+size_t Stemmer::step4(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("ment"))) return length - 4;
+    if (endsWith(word, length, SUFFIX("ness"))) return length - 4;
+    if (endsWith(word, length, SUFFIX("tion"))) return replaceEnding(word, length, 4, SUFFIX("t"));
+    return length;
 }
 
-std::string Stemmer::step5(const std::string& str) {
-    if (ends_with(str, "e") && str.length() > 4) {
-        return replaceEnding(str, "e", "");
+size_t Stemmer::step5(char* word, size_t length) {
+    if (endsWith(word, length, SUFFIX("e")) && length > 4) {
+        return length - 1;
     }
-    return str;
-} 
\ No newline at end of file
+    return length;
+}
+
+#undef SUFFIX
@@ -1,33 +1,255 @@
 #include "StopWords.h"
 #include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
 
-StopWords::StopWords() {
-    loadDefaultStopWords();
+namespace {
+
+constexpr char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// FNV-1a over the lowercased bytes
+constexpr uint64_t hashWord(std::string_view word) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : word) {
+        hash ^= static_cast<unsigned char>(toLower(c));
+        hash *= 1099511628211ull;
+    }
+    return hash;
 }
 
-bool StopWords::isStopWord(const std::string& word) const {
-    // Convert word to lowercase for comparison
-    std::string lowerWord = word;
-    std::transform(lowerWord.begin(), lowerWord.end(), lowerWord.begin(), ::tolower);
-    return stopWordsSet.find(lowerWord) != stopWordsSet.end();
+// Slot of a word with the given hash under its bucket's seed
+constexpr size_t slotOf(uint64_t hash, uint32_t seed, size_t slotMask) {
+    uint64_t x = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return static_cast<size_t>(x) & slotMask;
+}
+
+constexpr size_t bucketOf(uint64_t hash, size_t bucketMask) {
+    return static_cast<size_t>(hash >> 40) & bucketMask;
+}
+
+constexpr size_t nextPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Lay out count unique lowercase words. Buckets are seeded largest first,
+// which is when the table is emptiest. Works the same on std::array (at
+// compile time) and std::vector (for custom lists); T provides words,
+// hashes, order, starts (bucketCount + 1), seeds and slots, all presized.
+// Returns false if some bucket could not be placed, e.g. on duplicates.
+template <typename T>
+constexpr bool buildTable(T& table, size_t count, size_t bucketMask, size_t slotMask) {
+    size_t bucketCount = bucketMask + 1;
+
+    // Counting sort of the words by bucket
+    for (size_t b = 0; b <= bucketCount; b++) table.starts[b] = 0;
+    for (size_t i = 0; i < count; i++) {
+        table.hashes[i] = hashWord(table.words[i]);
+        table.starts[bucketOf(table.hashes[i], bucketMask) + 1]++;
+    }
+    size_t largest = 0;
+    for (size_t b = 0; b < bucketCount; b++) {
+        largest = std::max<size_t>(largest, table.starts[b + 1]);
+        table.starts[b + 1] += table.starts[b];
+    }
+    for (size_t b = 0; b < bucketCount; b++) table.seeds[b] = table.starts[b];
+    for (size_t i = 0; i < count; i++) {
+        table.order[table.seeds[bucketOf(table.hashes[i], bucketMask)]++] = i;
+    }
+    for (size_t b = 0; b < bucketCount; b++) table.seeds[b] = 0;
+    for (size_t s = 0; s <= slotMask; s++) table.slots[s] = std::string_view();
+
+    for (size_t size = largest; size > 0; size--) {
+        for (size_t b = 0; b < bucketCount; b++) {
+            size_t begin = table.starts[b];
+            size_t end = table.starts[b + 1];
+            if (end - begin != size) continue;
+
+            bool placed = false;
+            for (uint32_t seed = 1; seed < (1u << 20) && !placed; seed++) {
+                size_t next = begin;
+                for (; next < end; next++) {
+                    size_t slot = slotOf(table.hashes[table.order[next]], seed, slotMask);
+                    if (!table.slots[slot].empty()) break;
+                    table.slots[slot] = table.words[table.order[next]];
+                }
+                if (next == end) {
+                    table.seeds[b] = seed;
+                    placed = true;
+                } else {
+                    // Undo this attempt
+                    for (size_t j = begin; j < next; j++) {
+                        table.slots[slotOf(table.hashes[table.order[j]], seed, slotMask)] = std::string_view();
+                    }
+                }
+            }
+            if (!placed) return false;
+        }
+    }
+    return true;
 }
 
-void StopWords::loadDefaultStopWords() {
-    // Common English stop words
-    const char* defaultStopWords[] = {
-        "a", "an", "and", "are", "as", "at", "be", "by", "for", "from",
-        "has", "he", "in", "is", "it", "its", "of", "on", "that", "the",
-        "to", "was", "were", "will", "with", "the", "this", "but", "they",
-        "have", "had", "what", "when", "where", "who", "which", "why", "how",
-        "all", "any", "both", "each", "few", "more", "most", "other", "some",
-        "such", "no", "nor", "not", "only", "own", "same", "so", "than",
-        "too", "very", "can", "will", "just", "should", "now", "i", "you",
-        "your", "we", "my", "me", "her", "his", "their", "our", "us", "am",
-        "been", "being", "do", "does", "did", "doing", "would", "could",
-        "might", "must", "shall", "into", "if", "then", "else", "about"
-    };
+// Common English stop words
+constexpr std::string_view DEFAULT_WORDS[] = {
+    "a", "an", "and", "are", "as", "at", "be", "by", "for", "from",
+    "has", "he", "in", "is", "it", "its", "of", "on", "that", "the",
+    "to", "was", "were", "will", "with", "this", "but", "they",
+    "have", "had", "what", "when", "where", "who", "which", "why", "how",
+    "all", "any", "both", "each", "few", "more", "most", "other", "some",
+    "such", "no", "nor", "not", "only", "own", "same", "so", "than",
+    "too", "very", "can", "just", "should", "now", "i", "you",
+    "your", "we", "my", "me", "her", "his", "their", "our", "us", "am",
+    "been", "being", "do", "does", "did", "doing", "would", "could",
+    "might", "must", "shall", "into", "if", "then", "else", "about"
+};
 
-    for (const auto& word : defaultStopWords) {
-        stopWordsSet.insert(word);
+constexpr size_t DEFAULT_COUNT = std::size(DEFAULT_WORDS);
+constexpr size_t DEFAULT_BUCKETS = nextPowerOfTwo(DEFAULT_COUNT / 2);
+constexpr size_t DEFAULT_SLOTS = nextPowerOfTwo(DEFAULT_COUNT * 2);
+
+struct DefaultTable {
+    std::array<std::string_view, DEFAULT_COUNT> words{};
+    std::array<uint64_t, DEFAULT_COUNT> hashes{};
+    std::array<size_t, DEFAULT_COUNT> order{};
+    std::array<size_t, DEFAULT_BUCKETS + 1> starts{};
+    std::array<uint32_t, DEFAULT_BUCKETS> seeds{};
+    std::array<std::string_view, DEFAULT_SLOTS> slots{};
+    size_t maxLength = 0;
+    bool valid = false;
+};
+
+constexpr DefaultTable buildDefaultTable() {
+    DefaultTable table;
+    for (size_t i = 0; i < DEFAULT_COUNT; i++) {
+        table.words[i] = DEFAULT_WORDS[i];
+        table.maxLength = std::max(table.maxLength, DEFAULT_WORDS[i].size());
     }
-} 
\ No newline at end of file
+    table.valid = buildTable(table, DEFAULT_COUNT, DEFAULT_BUCKETS - 1, DEFAULT_SLOTS - 1);
+    return table;
+}
+
+constexpr DefaultTable DEFAULT_TABLE = buildDefaultTable();
+static_assert(DEFAULT_TABLE.valid, "default stopwords must be unique and lowercase");
+
+} // namespace
+
+struct StopWords::CustomTable {
+    std::vector<std::string> storage;
+    std::vector<std::string_view> words;
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> order;
+    std::vector<size_t> starts;
+    std::vector<uint32_t> seeds;
+    std::vector<std::string_view> slots;
+};
+
+StopWords::StopWords()
+    : seeds(DEFAULT_TABLE.seeds.data()),
+      slots(DEFAULT_TABLE.slots.data()),
+      bucketMask(DEFAULT_BUCKETS - 1),
+      slotMask(DEFAULT_SLOTS - 1),
+      count(DEFAULT_COUNT),
+      maxLength(DEFAULT_TABLE.maxLength) {}
+
+StopWords::StopWords(const std::vector<std::string>& words) {
+    auto table = std::make_shared<CustomTable>();
+
+    // Lowercase and drop duplicates before laying out
+    for (const auto& word : words) {
+        if (word.empty()) continue;
+        std::string lower(word);
+        std::transform(lower.begin(), lower.end(), lower.begin(), toLower);
+        table->storage.push_back(std::move(lower));
+    }
+    std::sort(table->storage.begin(), table->storage.end());
+    table->storage.erase(std::unique(table->storage.begin(), table->storage.end()),
+                         table->storage.end());
+
+    count = table->storage.size();
+    maxLength = 0;
+    for (const auto& word : table->storage) {
+        table->words.push_back(word);
+        maxLength = std::max(maxLength, word.size());
+    }
+
+    size_t bucketCount = nextPowerOfTwo(std::max<size_t>(count / 2, 1));
+    size_t slotCount = nextPowerOfTwo(std::max<size_t>(count * 2, 1));
+    table->hashes.resize(count);
+    table->order.resize(count);
+    table->starts.resize(bucketCount + 1);
+    table->seeds.resize(bucketCount);
+    table->slots.resize(slotCount);
+    if (!buildTable(*table, count, bucketCount - 1, slotCount - 1)) {
+        throw std::runtime_error("Could not build stopword table");
+    }
+
+    seeds = table->seeds.data();
+    slots = table->slots.data();
+    bucketMask = bucketCount - 1;
+    slotMask = slotCount - 1;
+    custom = std::move(table);
+}
+
+StopWords StopWords::fromFile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Could not open stopword list: " + path);
+    }
+
+    std::vector<std::string> words;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        words.push_back(line.substr(begin, end - begin + 1));
+    }
+    return StopWords(words);
+}
+
+bool StopWords::write(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    for (const auto& word : words()) {
+        out << word << '\n';
+    }
+    out.close();
+    return !out.fail();
+}
+
+std::vector<std::string> StopWords::words() const {
+    std::vector<std::string> result;
+    if (custom) {
+        result = custom->storage;
+    } else {
+        result.assign(std::begin(DEFAULT_WORDS), std::end(DEFAULT_WORDS));
+        std::sort(result.begin(), result.end());
+    }
+    return result;
+}
+
+bool StopWords::isStopWord(std::string_view word) const {
+    if (word.empty() || word.size() > maxLength || count == 0) {
+        return false;
+    }
+
+    uint64_t hash = hashWord(word);
+    std::string_view candidate = slots[slotOf(hash, seeds[bucketOf(hash, bucketMask)], slotMask)];
+    if (candidate.size() != word.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < word.size(); i++) {
+        if (toLower(word[i]) != candidate[i]) return false;
+    }
+    return true;
+}
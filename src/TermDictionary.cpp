@@ -0,0 +1,266 @@
+#include "TermDictionary.h"
+#include "BinaryIO.h"
+#include <algorithm>
+#include <utility>
+
+using BinaryIO::load;
+using BinaryIO::readVarint;
+using BinaryIO::writeVarint;
+
+TermDictionary::TermDictionary() : data(nullptr), length(0), count(0), blockCount(0) {}
+
+TermDictionary::TermDictionary(std::vector<uint8_t> encoded) : TermDictionary() {
+    owned = std::move(encoded);
+    open(owned.data(), owned.size());
+}
+
+TermDictionary::TermDictionary(TermDictionary&& other) noexcept
+    : owned(std::move(other.owned)), data(other.data), length(other.length),
+      count(other.count), blockCount(other.blockCount) {
+    other.data = nullptr;
+    other.length = other.count = other.blockCount = 0;
+}
+
+TermDictionary& TermDictionary::operator=(TermDictionary&& other) noexcept {
+    if (this != &other) {
+        owned = std::move(other.owned);
+        data = other.data;
+        length = other.length;
+        count = other.count;
+        blockCount = other.blockCount;
+        other.data = nullptr;
+        other.length = other.count = other.blockCount = 0;
+    }
+    return *this;
+}
+
+bool TermDictionary::open(const uint8_t* bytes, size_t size) {
+    data = nullptr;
+    length = count = blockCount = 0;
+    if (size < 8) {
+        return false;
+    }
+
+    size_t keys = load<uint32_t>(bytes);
+    size_t blocks = load<uint32_t>(bytes + 4);
+    if (blocks != (keys + BLOCK_SIZE - 1) / BLOCK_SIZE ||
+        8 + blocks * 4 > size ||
+        (blocks > 0 && load<uint32_t>(bytes + 8 + (blocks - 1) * 4) >= size)) {
+        return false;
+    }
+
+    data = bytes;
+    length = size;
+    count = keys;
+    blockCount = blocks;
+    return true;
+}
+
+const uint8_t* TermDictionary::block(size_t index) const {
+    return data + load<uint32_t>(data + 8 + index * 4);
+}
+
+std::string_view TermDictionary::blockHead(size_t index) const {
+    uint32_t shared;
+    uint32_t suffixLength;
+    const uint8_t* in = readVarint(block(index), shared);
+    in = readVarint(in, suffixLength);
+    return std::string_view(reinterpret_cast<const char*>(in), suffixLength);
+}
+
+size_t TermDictionary::search(std::string_view key, bool& found) const {
+    found = false;
+
+    // Last block whose head is <= key
+    size_t low = 0;
+    size_t high = blockCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (blockHead(mid) <= key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return 0;
+    }
+
+    // Walk the block. The previous key is below key and agrees with it on
+    // exactly `matched` bytes, so an entry sharing more than that with the
+    // previous key is still below key, and one sharing less is above it;
+    // only entries sharing exactly `matched` bytes need their suffix compared.
+    size_t ordinal = (low - 1) * BLOCK_SIZE;
+    size_t end = std::min(ordinal + BLOCK_SIZE, count);
+    const uint8_t* in = block(low - 1);
+    size_t matched = 0;
+    for (; ordinal < end; ++ordinal) {
+        uint32_t shared;
+        uint32_t suffixLength;
+        in = readVarint(in, shared);
+        in = readVarint(in, suffixLength);
+        const uint8_t* suffix = in;
+        in += suffixLength;
+
+        if (shared > matched) continue;
+        if (shared < matched) return ordinal;
+
+        const uint8_t* rest = reinterpret_cast<const uint8_t*>(key.data()) + matched;
+        size_t restLength = key.size() - matched;
+        size_t limit = std::min<size_t>(suffixLength, restLength);
+        size_t common = 0;
+        while (common < limit && suffix[common] == rest[common]) {
+            ++common;
+        }
+        if (common == restLength) {
+            found = common == suffixLength;
+            return ordinal;
+        }
+        if (common < suffixLength && suffix[common] > rest[common]) {
+            return ordinal;
+        }
+        matched += common;
+    }
+    return ordinal;
+}
+
+size_t TermDictionary::find(std::string_view key) const {
+    bool found;
+    size_t ordinal = search(key, found);
+    return found ? ordinal : NOT_FOUND;
+}
+
+size_t TermDictionary::lowerBound(std::string_view key) const {
+    bool found;
+    return search(key, found);
+}
+
+std::string TermDictionary::keyAt(size_t ordinal) const {
+    Cursor it = cursor(ordinal);
+    return it.valid() ? std::string(it.key()) : std::string();
+}
+
+TermDictionary::Cursor::Cursor(const TermDictionary& dictionary, size_t ordinal)
+    : in(nullptr), index(dictionary.count), count(dictionary.count) {
+    if (ordinal >= count) {
+        return;
+    }
+
+    // Decode from the head of the ordinal's block
+    in = dictionary.block(ordinal / BLOCK_SIZE);
+    index = ordinal - ordinal % BLOCK_SIZE;
+    decode();
+    while (index < ordinal) {
+        next();
+    }
+}
+
+void TermDictionary::Cursor::next() {
+    // Blocks are stored back to back, so decoding just carries on
+    if (++index < count) {
+        decode();
+    }
+}
+
+void TermDictionary::Cursor::decode() {
+    uint32_t shared;
+    uint32_t suffixLength;
+    in = readVarint(in, shared);
+    in = readVarint(in, suffixLength);
+    current.resize(shared);
+    current.append(reinterpret_cast<const char*>(in), suffixLength);
+    in += suffixLength;
+}
+
+TermDictionaryBuilder::TermDictionaryBuilder() : count(0) {}
+
+void TermDictionaryBuilder::add(std::string_view key) {
+    size_t shared = 0;
+    if (count % TermDictionary::BLOCK_SIZE == 0) {
+        blockOffsets.push_back(static_cast<uint32_t>(entries.size()));
+    } else {
+        size_t limit = std::min(previous.size(), key.size());
+        while (shared < limit && previous[shared] == key[shared]) {
+            ++shared;
+        }
+    }
+
+    writeVarint(entries, static_cast<uint32_t>(shared));
+    writeVarint(entries, static_cast<uint32_t>(key.size() - shared));
+    entries.insert(entries.end(), key.begin() + shared, key.end());
+    previous.assign(key.data(), key.size());
+    count++;
+}
+
+std::vector<uint8_t> TermDictionaryBuilder::finish() {
+    size_t headerSize = 8 + blockOffsets.size() * 4;
+    std::vector<uint8_t> encoded;
+    encoded.reserve(headerSize + entries.size());
+    BinaryIO::append<uint32_t>(encoded, static_cast<uint32_t>(count));
+    BinaryIO::append<uint32_t>(encoded, static_cast<uint32_t>(blockOffsets.size()));
+    for (uint32_t offset : blockOffsets) {
+        BinaryIO::append<uint32_t>(encoded, static_cast<uint32_t>(headerSize + offset));
+    }
+    encoded.insert(encoded.end(), entries.begin(), entries.end());
+
+    entries.clear();
+    blockOffsets.clear();
+    previous.clear();
+    count = 0;
+    return encoded;
+}
+
+SuffixIndex::SuffixIndex() : ordinals(nullptr), length(0) {}
+
+SuffixIndex::SuffixIndex(std::vector<uint8_t> encoded) : SuffixIndex() {
+    owned = std::move(encoded);
+    open(owned.data(), owned.size());
+}
+
+bool SuffixIndex::open(const uint8_t* data, size_t size) {
+    reversed = TermDictionary();
+    ordinals = nullptr;
+    length = 0;
+    if (size < 4) {
+        return false;
+    }
+
+    size_t dictionaryBytes = load<uint32_t>(data);
+    if (4 + dictionaryBytes > size || !reversed.open(data + 4, dictionaryBytes) ||
+        4 + dictionaryBytes + reversed.size() * 4 > size) {
+        reversed = TermDictionary();
+        return false;
+    }
+    ordinals = data + 4 + dictionaryBytes;
+    length = size;
+    return true;
+}
+
+size_t SuffixIndex::forwardOrdinal(size_t reversedOrdinal) const {
+    return load<uint32_t>(ordinals + reversedOrdinal * 4);
+}
+
+std::vector<uint8_t> SuffixIndex::build(const TermDictionary& keys) {
+    std::vector<std::pair<std::string, uint32_t>> reversedKeys;
+    reversedKeys.reserve(keys.size());
+    for (auto it = keys.cursor(); it.valid(); it.next()) {
+        reversedKeys.emplace_back(std::string(it.key().rbegin(), it.key().rend()),
+                                  static_cast<uint32_t>(it.ordinal()));
+    }
+    std::sort(reversedKeys.begin(), reversedKeys.end());
+
+    TermDictionaryBuilder builder;
+    for (const auto& entry : reversedKeys) {
+        builder.add(entry.first);
+    }
+    std::vector<uint8_t> dictionary = builder.finish();
+
+    std::vector<uint8_t> encoded;
+    encoded.reserve(4 + dictionary.size() + reversedKeys.size() * 4);
+    BinaryIO::append<uint32_t>(encoded, static_cast<uint32_t>(dictionary.size()));
+    encoded.insert(encoded.end(), dictionary.begin(), dictionary.end());
+    for (const auto& entry : reversedKeys) {
+        BinaryIO::append<uint32_t>(encoded, entry.second);
+    }
+    return encoded;
+}
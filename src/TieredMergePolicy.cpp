@@ -0,0 +1,68 @@
+#include "TieredMergePolicy.h"
+#include <algorithm>
+
+TieredMergePolicy::TieredMergePolicy(size_t mergeFactor, size_t minSegmentDocuments,
+                                     size_t maxMergedDocuments, double maxDeletedShare)
+    : mergeFactor(std::max<size_t>(2, mergeFactor)),
+      minSegmentDocuments(std::max<size_t>(1, minSegmentDocuments)),
+      maxMergedDocuments(maxMergedDocuments), maxDeletedShare(maxDeletedShare) {}
+
+size_t TieredMergePolicy::tier(size_t documents) const {
+    size_t result = 0;
+    for (size_t limit = minSegmentDocuments; documents > limit; limit *= mergeFactor) {
+        result++;
+    }
+    return result;
+}
+
+bool TieredMergePolicy::findMerge(const std::vector<size_t>& liveDocuments, const std::vector<size_t>& deletedDocuments,
+                                  size_t& first, size_t& count) const {
+    std::vector<size_t> tiers;
+    for (size_t documents : liveDocuments) {
+        tiers.push_back(tier(documents));
+    }
+
+    // Lowest tier with a full run of adjacent segments; the leftmost run
+    // within it
+    bool found = false;
+    size_t foundTier = 0;
+    size_t runStart = 0;
+    for (size_t i = 0; i < tiers.size(); ++i) {
+        if (i > 0 && tiers[i] != tiers[i - 1]) {
+            runStart = i;
+        }
+        if (i + 1 - runStart < mergeFactor || (found && tiers[i] >= foundTier)) {
+            continue;
+        }
+
+        size_t start = i + 1 - mergeFactor;
+        size_t documents = 0;
+        for (size_t j = start; j <= i; ++j) {
+            documents += liveDocuments[j];
+        }
+        if (documents <= maxMergedDocuments) {
+            found = true;
+            foundTier = tiers[i];
+            first = start;
+            count = mergeFactor;
+        }
+    }
+    if (found) {
+        return true;
+    }
+
+    // Otherwise the segment with the largest share of deleted documents,
+    // if that is too large
+    double largestShare = maxDeletedShare;
+    for (size_t i = 0; i < deletedDocuments.size() && i < liveDocuments.size(); ++i) {
+        size_t documents = liveDocuments[i] + deletedDocuments[i];
+        double share = documents ? static_cast<double>(deletedDocuments[i]) / documents : 0.0;
+        if (share > largestShare) {
+            largestShare = share;
+            first = i;
+            count = 1;
+            found = true;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,190 @@
+#include "Tokenizer.h"
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define SUPERSEARCH_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// What to do with each byte value
+enum CharClass : uint8_t {
+    DROP = 0,       // skipped without ending the token
+    SEPARATOR = 1,  // whitespace or punctuation, ends the token
+    KEEP = 2        // letter or digit
+};
+
+struct CharTable {
+    uint8_t classes[256];
+    char lower[256];
+
+    CharTable() {
+        for (int c = 0; c < 256; ++c) {
+            bool space = c == ' ' || (c >= '\t' && c <= '\r');
+            bool punct = c > ' ' && c < 0x7F &&
+                         !(c >= '0' && c <= '9') && !(c >= 'A' && c <= 'Z') && !(c >= 'a' && c <= 'z');
+            bool alnum = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+
+            classes[c] = alnum ? KEEP : (space || punct) ? SEPARATOR : DROP;
+            lower[c] = static_cast<char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+        }
+    }
+};
+
+const CharTable table;
+
+// Output position shared by the scalar and vector paths
+struct Cursor {
+    char* out;
+    char* tokenStart;
+    std::vector<std::string_view>& tokens;
+};
+
+inline void endToken(Cursor& cursor) {
+    if (cursor.out != cursor.tokenStart) {
+        cursor.tokens.emplace_back(cursor.tokenStart, cursor.out - cursor.tokenStart);
+    }
+    cursor.tokenStart = cursor.out;
+}
+
+void tokenizeScalar(const char* in, size_t length, Cursor& cursor) {
+    for (size_t i = 0; i < length; ++i) {
+        uint8_t c = static_cast<uint8_t>(in[i]);
+        switch (table.classes[c]) {
+            case KEEP:
+                *cursor.out++ = table.lower[c];
+                break;
+            case SEPARATOR:
+                endToken(cursor);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#ifdef SUPERSEARCH_X86_SIMD
+
+// Copy the runs of kept bytes of one chunk and end tokens at separator runs.
+// Only valid for chunks without DROP bytes.
+inline void emitRuns(const char* lowered, uint64_t keep, unsigned width, Cursor& cursor) {
+    unsigned pos = 0;
+    while (pos < width) {
+        uint64_t rest = keep >> pos;
+        unsigned run;
+        if (rest & 1) {
+            run = static_cast<unsigned>(__builtin_ctzll(~rest));
+            std::memcpy(cursor.out, lowered + pos, run);
+            cursor.out += run;
+        } else {
+            endToken(cursor);
+            run = rest ? static_cast<unsigned>(__builtin_ctzll(rest)) : width - pos;
+        }
+        pos += run;
+    }
+}
+
+// Unsigned lo <= c <= hi for every byte
+inline __m128i inRange16(__m128i c, char lo, char hi) {
+    __m128i offset = _mm_sub_epi8(c, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(static_cast<char>(hi - lo))), offset);
+}
+
+// SSE2 is part of x86-64, so this needs no runtime check. Returns the number
+// of bytes consumed (a multiple of 16); the caller finishes the tail.
+size_t tokenizeSse2(const char* in, size_t length, Cursor& cursor) {
+    alignas(16) char lowered[16];
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i upper = inRange16(c, 'A', 'Z');
+        __m128i keep = _mm_or_si128(_mm_or_si128(upper, inRange16(c, 'a', 'z')), inRange16(c, '0', '9'));
+        __m128i space = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), inRange16(c, '\t', '\r'));
+        __m128i printable = inRange16(c, 0x21, 0x7E);
+        __m128i separator = _mm_or_si128(space, _mm_andnot_si128(keep, printable));
+
+        uint64_t keepMask = static_cast<uint32_t>(_mm_movemask_epi8(keep));
+        uint64_t separatorMask = static_cast<uint32_t>(_mm_movemask_epi8(separator));
+        if ((keepMask | separatorMask) != 0xFFFF) {
+            tokenizeScalar(in + i, 16, cursor);
+            continue;
+        }
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(lowered),
+                        _mm_or_si128(c, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+        emitRuns(lowered, keepMask, 16, cursor);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline __m256i inRange32(__m256i c, char lo, char hi) {
+    __m256i offset = _mm256_sub_epi8(c, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(static_cast<char>(hi - lo))), offset);
+}
+
+__attribute__((target("avx2")))
+size_t tokenizeAvx2(const char* in, size_t length, Cursor& cursor) {
+    alignas(32) char lowered[32];
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i upper = inRange32(c, 'A', 'Z');
+        __m256i keep = _mm256_or_si256(_mm256_or_si256(upper, inRange32(c, 'a', 'z')), inRange32(c, '0', '9'));
+        __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), inRange32(c, '\t', '\r'));
+        __m256i printable = inRange32(c, 0x21, 0x7E);
+        __m256i separator = _mm256_or_si256(space, _mm256_andnot_si256(keep, printable));
+
+        uint64_t keepMask = static_cast<uint32_t>(_mm256_movemask_epi8(keep));
+        uint64_t separatorMask = static_cast<uint32_t>(_mm256_movemask_epi8(separator));
+        if ((keepMask | separatorMask) != 0xFFFFFFFFull) {
+            tokenizeScalar(in + i, 32, cursor);
+            continue;
+        }
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lowered),
+                           _mm256_or_si256(c, _mm256_and_si256(upper, _mm256_set1_epi8(0x20))));
+        emitRuns(lowered, keepMask, 32, cursor);
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+Tokenizer::Kernel Tokenizer::selectKernel() {
+#ifdef SUPERSEARCH_X86_SIMD
+    static const Kernel kernel = __builtin_cpu_supports("avx2") ? Kernel::AVX2 : Kernel::SSE2;
+    return kernel;
+#else
+    return Kernel::SCALAR;
+#endif
+}
+
+void Tokenizer::tokenize(char* data, size_t length, std::vector<std::string_view>& tokens) {
+    tokenize(data, length, tokens, selectKernel());
+}
+
+void Tokenizer::tokenize(char* data, size_t length, std::vector<std::string_view>& tokens,
+                         Kernel kernel) {
+    tokens.clear();
+    Cursor cursor{data, data, tokens};
+
+    // Output never overtakes input, so each chunk is read before it can be
+    // overwritten
+    size_t done = 0;
+#ifdef SUPERSEARCH_X86_SIMD
+    if (kernel == Kernel::AVX2) {
+        done = tokenizeAvx2(data, length, cursor);
+    } else if (kernel == Kernel::SSE2) {
+        done = tokenizeSse2(data, length, cursor);
+    }
+#else
+    (void)kernel;
+#endif
+    tokenizeScalar(data + done, length - done, cursor);
+    endToken(cursor);
+}
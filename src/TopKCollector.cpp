@@ -0,0 +1,31 @@
+#include "TopKCollector.h"
+#include <algorithm>
+#include <limits>
+
+TopKCollector::TopKCollector(size_t capacity) : capacity(capacity) {}
+
+void TopKCollector::offer(double score, uint32_t docId) {
+    ScoredDoc hit{score, docId};
+
+    // With ranksBefore as the ordering, the heap's top is the weakest hit
+    if (heap.size() < capacity) {
+        heap.push_back(hit);
+        std::push_heap(heap.begin(), heap.end(), ranksBefore);
+    } else if (capacity > 0 && ranksBefore(hit, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), ranksBefore);
+        heap.back() = hit;
+        std::push_heap(heap.begin(), heap.end(), ranksBefore);
+    }
+}
+
+double TopKCollector::threshold() const {
+    return full() && !heap.empty() ? heap.front().score
+                                   : -std::numeric_limits<double>::infinity();
+}
+
+std::vector<ScoredDoc> TopKCollector::takeSorted() {
+    std::sort_heap(heap.begin(), heap.end(), ranksBefore);
+    std::vector<ScoredDoc> result;
+    result.swap(heap);
+    return result;
+}
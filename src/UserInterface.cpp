@@ -67,14 +67,16 @@ void UserInterface::createIndex() {
     std::cout << "Indexing documents from " << directoryPath << "...\n";
     
     try {
-        auto documents = docParser->parseDirectory(directoryPath);
+        // Documents go straight from the parser into the index, parsed with
+        // the stopwords of the index they join
+        docParser->setStopWords(indexHandler->stopWords());
+        size_t count = docParser->parseDirectory(directoryPath, [this](std::unique_ptr<Document> doc) {
+            std::cout << "Indexing: " << doc->getFilePath() << std::endl;
+            indexHandler->addDocument(std::move(doc));
+        });
         
-        std::cout << "Found " << documents.size() << " documents.\n";
-        std::cout << "Adding documents to index...\n";
-        
-        for (const auto& doc : documents) {
-            indexHandler->addDocument(doc);
-        }
+        std::cout << "Indexed " << count << " documents.\n";
+        indexHandler->finalizeIndex();
         
         std::cout << "Indexing complete.\n";
     }
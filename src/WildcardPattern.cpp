@@ -0,0 +1,95 @@
+#include "WildcardPattern.h"
+#include <algorithm>
+
+namespace {
+
+bool isWildcard(char c) {
+    return c == '*' || c == '?';
+}
+
+} // namespace
+
+WildcardPattern::WildcardPattern(std::string_view text) : pattern(text) {
+    size_t first = pattern.find_first_of("*?");
+    size_t last = pattern.find_last_of("*?");
+    prefixLength = first == std::string::npos ? pattern.size() : first;
+    suffixLength = last == std::string::npos ? pattern.size() : pattern.size() - last - 1;
+}
+
+bool WildcardPattern::isPattern(std::string_view term) {
+    return std::any_of(term.begin(), term.end(), isWildcard);
+}
+
+std::string WildcardPattern::normalize(std::string_view token) {
+    std::string result;
+    for (char c : token) {
+        if (c >= 'A' && c <= 'Z') {
+            result += static_cast<char>(c - 'A' + 'a');
+        } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '?') {
+            result += c;
+        } else if (c == '*' && (result.empty() || result.back() != '*')) {
+            result += c;
+        }
+    }
+    return result;
+}
+
+bool WildcardPattern::matches(std::string_view key) const {
+    // Greedy glob match: on a mismatch, let the last '*' swallow one more
+    // character and retry from there
+    size_t p = 0;
+    size_t k = 0;
+    size_t star = std::string::npos;
+    size_t starKey = 0;
+    while (k < key.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == key[k])) {
+            ++p;
+            ++k;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            starKey = k;
+        } else if (star != std::string::npos) {
+            p = star + 1;
+            k = ++starKey;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+std::vector<size_t> WildcardPattern::expand(const TermDictionary& keys, const SuffixIndex& suffixes,
+                                            bool& truncated) const {
+    std::vector<size_t> ordinals;
+    truncated = false;
+
+    // Walk the keys sharing the longer literal end; with neither, all of them
+    bool bySuffix = suffixLength > prefixLength;
+    const TermDictionary& scanned = bySuffix ? suffixes.reversedKeys() : keys;
+    std::string literal = bySuffix ? std::string(pattern.rbegin(), pattern.rbegin() + suffixLength)
+                                   : pattern.substr(0, prefixLength);
+
+    size_t checked = 0;
+    for (auto it = scanned.cursor(scanned.lowerBound(literal)); it.valid(); it.next()) {
+        if (it.key().compare(0, literal.size(), literal) != 0) break;
+        if (checked++ == MAX_SCANNED) {
+            truncated = true;
+            break;
+        }
+
+        bool matched = bySuffix ? matches(std::string(it.key().rbegin(), it.key().rend()))
+                                : matches(it.key());
+        if (!matched) continue;
+        if (ordinals.size() == MAX_EXPANSIONS) {
+            truncated = true;
+            break;
+        }
+        ordinals.push_back(bySuffix ? suffixes.forwardOrdinal(it.ordinal()) : it.ordinal());
+    }
+
+    std::sort(ordinals.begin(), ordinals.end());
+    return ordinals;
+}
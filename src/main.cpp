@@ -1,14 +1,35 @@
+#include <csignal>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "IndexHandler.h"
+#include "IngestPipeline.h"
 #include "DocumentParser.h"
 #include "QueryProcessor.h"
+#include "QueryServer.h"
 #include "UserInterface.h"
 
+namespace {
+
+// Server to stop on SIGINT or SIGTERM
+QueryServer* activeServer = nullptr;
+
+void stopServer(int) {
+    if (activeServer) {
+        activeServer->stop();
+    }
+}
+
+} // namespace
+
 void printUsage() {
     std::cout << "Usage:\n";
-    std::cout << "  supersearch index <directory>\n";
+    std::cout << "  supersearch index <directory> [--threads <n>]\n";
+    std::cout << "                    [--stopwords <file>] [--positions]\n";
+    std::cout << "  supersearch update <file>...\n";
+    std::cout << "  supersearch remove <file>...\n";
     std::cout << "  supersearch query \"<query>\"\n";
+    std::cout << "  supersearch serve [--port <n>] [--threads <n>]\n";
     std::cout << "  supersearch ui\n";
 }
 
@@ -28,22 +49,98 @@ int main(int argc, char* argv[]) {
             }
             std::string directoryPath = argv[2];
 
+            // Parser threads; 0 means one per hardware thread
+            size_t threadCount = 0;
+            std::string stopWordsPath;
+            bool storePositions = false;
+            for (int i = 3; i < argc; ++i) {
+                std::string option = argv[i];
+                if (option == "--threads" && i + 1 < argc) {
+                    threadCount = std::stoul(argv[++i]);
+                } else if (option == "--stopwords" && i + 1 < argc) {
+                    stopWordsPath = argv[++i];
+                } else if (option == "--positions") {
+                    storePositions = true;
+                } else {
+                    std::cout << "Unknown option: " << option << std::endl;
+                    printUsage();
+                    return 1;
+                }
+            }
+
             // Create objects
             auto indexHandler = std::make_unique<IndexHandler>();
-            auto docParser = std::make_unique<DocumentParser>();
+            indexHandler->setStorePositions(storePositions);
+            IngestPipeline pipeline(threadCount);
+            if (!stopWordsPath.empty()) {
+                // Custom list replaces the built-in one, and is saved with
+                // the index for queries and updates
+                StopWords stopWords = StopWords::fromFile(stopWordsPath);
+                pipeline.setStopWords(stopWords);
+                indexHandler->setStopWords(stopWords);
+            }
 
             // Parse and index documents
-            std::cout << "Indexing documents...\n";
-            auto documents = docParser->parseDirectory(directoryPath);
-            
-            for (const auto& doc : documents) {
-                indexHandler->addDocument(doc);
+            std::cout << "Indexing documents with " << pipeline.getThreadCount() << " threads...\n";
+            pipeline.run(directoryPath, [&](std::unique_ptr<Document> doc) {
+                // Show which file is being indexed
+                std::cout << "Indexing: " << doc->getFilePath() << std::endl;
+                indexHandler->addDocument(std::move(doc));
+            });
+            indexHandler->finalizeIndex();
+
+            MergeStats merges = indexHandler->mergeStats();
+            if (merges.merges > 0) {
+                std::cout << "Background merges: " << merges.merges << " merges of " << merges.segmentsMerged
+                          << " segments, " << merges.bytesMerged / (1024 * 1024) << " MB at "
+                          << merges.bytesPerSecond() / (1024 * 1024) << " MB/s; "
+                          << merges.segmentCount << " segments left\n";
             }
 
             // Save indices
             indexHandler->saveIndices("index.dat");
             std::cout << "Indexing complete. Index saved to 'index.dat'\n";
 
+        } else if (command == "update" || command == "remove") {
+            if (argc < 3) {
+                std::cout << "Please specify the files to " << command << ".\n";
+                return 1;
+            }
+            std::vector<std::string> filePaths(argv + 2, argv + argc);
+
+            // Updated documents are parsed with the index's own stopwords
+            auto indexHandler = std::make_unique<IndexHandler>();
+            indexHandler->loadIndices("index.dat");
+            DocumentParser parser;
+            parser.setStopWords(indexHandler->stopWords());
+
+            // Files are matched by the path they were indexed under
+            size_t changed = 0;
+            for (const auto& filePath : filePaths) {
+                if (command == "remove") {
+                    if (indexHandler->removeDocument(filePath)) {
+                        changed++;
+                    } else {
+                        std::cout << "Not in the index: " << filePath << std::endl;
+                    }
+                    continue;
+                }
+                auto doc = parser.parseDocument(filePath);
+                if (!doc) {
+                    std::cout << "Cannot parse " << filePath << std::endl;
+                    continue;
+                }
+                if (!indexHandler->updateDocument(std::move(doc))) {
+                    std::cout << "Not in the index, added: " << filePath << std::endl;
+                }
+                changed++;
+            }
+            indexHandler->finalizeIndex();
+
+            indexHandler->saveIndices("index.dat");
+            std::cout << (command == "update" ? "Updated " : "Removed ") << changed
+                      << " documents. Index saved to 'index.dat'\n";
+
         } else if (command == "query") {
             if (argc < 3) {
                 std::cout << "Please specify a query.\n";
@@ -58,6 +155,35 @@ int main(int argc, char* argv[]) {
             auto queryProcessor = std::make_unique<QueryProcessor>(indexHandler.get());
             queryProcessor->processQuery(queryString);
 
+        } else if (command == "serve") {
+            uint16_t port = 8080;
+            size_t threadCount = 0;  // one per hardware thread
+            for (int i = 2; i < argc; ++i) {
+                std::string option = argv[i];
+                if (option == "--port" && i + 1 < argc) {
+                    port = static_cast<uint16_t>(std::stoul(argv[++i]));
+                } else if (option == "--threads" && i + 1 < argc) {
+                    threadCount = std::stoul(argv[++i]);
+                } else {
+                    std::cout << "Unknown option: " << option << std::endl;
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            // Load the index once; every request is answered from it
+            auto indexHandler = std::make_unique<IndexHandler>();
+            indexHandler->loadIndices("index.dat");
+
+            QueryServer server(indexHandler.get(), threadCount);
+            activeServer = &server;
+            std::signal(SIGINT, stopServer);
+            std::signal(SIGTERM, stopServer);
+            std::cout << "Serving index.dat on http://127.0.0.1:" << port << "/search?q=<query> with "
+                      << server.getThreadCount() << " threads (Ctrl-C to stop)" << std::endl;
+            server.serve(port);
+            activeServer = nullptr;
+
         } else if (command == "ui") {
             UserInterface ui;
             ui.start();
@@ -0,0 +1,209 @@
+#include "Bm25.h"
+#include "IndexHandler.h"
+#include "IndexTestSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Checks that ranked OR queries, which Block-Max WAND prunes, return the
+// same top-k as scoring every document with BM25. Random corpora are
+// spread over many segments, and checked again after some documents are
+// deleted and the index is saved and loaded, which compacts them away.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using IndexTestSupport::expect;
+using IndexTestSupport::makeDocument;
+
+constexpr size_t DOCUMENTS = 2000;
+constexpr size_t SEGMENT_SIZE = 37;
+constexpr size_t VOCABULARY = 300;
+constexpr size_t PLANS = 200;
+
+struct ReferenceDocument {
+    std::unordered_map<std::string, uint32_t> frequencies;
+    uint32_t length = 0;
+};
+
+// The documents the index should hold, by path
+using Corpus = std::map<std::string, ReferenceDocument>;
+
+std::string word(size_t rank) {
+    return "w" + std::to_string(rank);
+}
+
+// Words drawn with probability ~ 1/rank, so a few terms are in most
+// documents and most terms in few
+size_t drawWord(std::mt19937& rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    return static_cast<size_t>(std::pow(static_cast<double>(VOCABULARY), uniform(rng))) - 1;
+}
+
+Corpus buildIndex(IndexHandler& index, std::mt19937& rng) {
+    Corpus corpus;
+    for (size_t i = 0; i < DOCUMENTS; ++i) {
+        std::string path = "doc" + std::to_string(i);
+        ReferenceDocument& reference = corpus[path];
+        std::string text;
+        for (size_t length = 1 + rng() % 60; length > 0; --length) {
+            std::string term = word(drawWord(rng));
+            text += term + " ";
+            reference.frequencies[term]++;
+            reference.length++;
+        }
+        index.addDocument(makeDocument(path, text));
+    }
+    index.finalizeIndex();
+    index.waitForMerges();
+    return corpus;
+}
+
+// BM25 score of every matching document, best first
+std::vector<double> referenceScores(const Corpus& corpus, const std::vector<std::string>& terms,
+                                    std::unordered_map<std::string, double>& scores) {
+    uint64_t totalLength = 0;
+    for (const auto& entry : corpus) {
+        totalLength += entry.second.length;
+    }
+    Bm25 bm25(corpus.size(), static_cast<double>(totalLength) / corpus.size());
+
+    std::vector<double> idfs;
+    for (const auto& term : terms) {
+        uint32_t frequency = 0;
+        for (const auto& entry : corpus) {
+            frequency += entry.second.frequencies.count(term);
+        }
+        idfs.push_back(bm25.idf(frequency));
+    }
+
+    scores.clear();
+    std::vector<double> ranked;
+    for (const auto& entry : corpus) {
+        double score = 0.0;
+        bool matched = false;
+        for (size_t t = 0; t < terms.size(); ++t) {
+            auto found = entry.second.frequencies.find(terms[t]);
+            if (found != entry.second.frequencies.end()) {
+                score += bm25.score(idfs[t], found->second, entry.second.length);
+                matched = true;
+            }
+        }
+        if (matched) {
+            scores[entry.first] = score;
+            ranked.push_back(score);
+        }
+    }
+    std::sort(ranked.rbegin(), ranked.rend());
+    return ranked;
+}
+
+bool close(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+// Run random OR plans and compare each page with the exhaustive ranking.
+// Tied documents may come in any order, so pages are compared by score.
+void checkPlans(const IndexHandler& index, const Corpus& corpus, std::mt19937& rng, const std::string& step) {
+    static const size_t pageSizes[] = {1, 5, 10, 50};
+    for (size_t p = 0; p < PLANS; ++p) {
+        QueryPlan plan;
+        plan.matchMode = MatchMode::ANY;
+        std::set<size_t> ranks;
+        for (size_t count = 2 + rng() % 4; ranks.size() < count;) {
+            ranks.insert(drawWord(rng));
+        }
+        std::string description;
+        for (size_t rank : ranks) {
+            plan.terms.push_back(word(rank));
+            description += " " + word(rank);
+        }
+        size_t limit = pageSizes[rng() % 4];
+        size_t offset = rng() % 3 == 0 ? limit : 0;
+        std::string what = step + ", plan" + description + " limit " + std::to_string(limit) +
+                           " offset " + std::to_string(offset);
+
+        std::unordered_map<std::string, double> scores;
+        std::vector<double> ranked = referenceScores(corpus, plan.terms, scores);
+        SearchResults page = index.getTopDocuments(plan, limit, offset);
+
+        size_t expectedSize = ranked.size() > offset ? std::min(limit, ranked.size() - offset) : 0;
+        expect(page.documents.size() == expectedSize,
+               what + ": " + std::to_string(page.documents.size()) + " hits, expected " +
+               std::to_string(expectedSize));
+        expect(page.exactTotal ? page.totalMatches == ranked.size() : page.totalMatches <= ranked.size(),
+               what + ": total " + std::to_string(page.totalMatches) + " of " + std::to_string(ranked.size()));
+        for (size_t i = 0; i < page.documents.size() && i < expectedSize; ++i) {
+            auto found = scores.find(page.documents[i]->getFilePath());
+            bool matches = found != scores.end() && close(found->second, ranked[offset + i]);
+            expect(matches, what + ": hit " + std::to_string(offset + i) + " is " +
+                   page.documents[i]->getFilePath() + ", not a document scoring " +
+                   std::to_string(ranked[offset + i]));
+            if (!matches) {
+                return;
+            }
+        }
+    }
+}
+
+void checkSeed(unsigned seed, const fs::path& directory) {
+    std::mt19937 rng(seed);
+    std::string file = (directory / ("wand" + std::to_string(seed) + ".dat")).string();
+    std::string step = "seed " + std::to_string(seed);
+    Corpus corpus;
+    {
+        IndexHandler index;
+        // Merges stop at a few hundred documents, so the top-k threshold
+        // is carried across merged and unmerged segments alike
+        index.setSegmentSize(SEGMENT_SIZE);
+        index.setMergePolicy(TieredMergePolicy(4, SEGMENT_SIZE, 300));
+        corpus = buildIndex(index, rng);
+        expect(index.segmentCount() > 1, step + ", only one segment");
+        checkPlans(index, corpus, rng, step);
+
+        // Delete a tenth of the documents; saving compacts them away
+        for (size_t i = 0; i < DOCUMENTS / 10; ++i) {
+            std::string path = "doc" + std::to_string(rng() % DOCUMENTS);
+            if (corpus.erase(path) > 0) {
+                expect(index.removeDocument(path), step + ", remove " + path);
+            }
+        }
+        index.saveIndices(file);
+    }
+    IndexHandler index;
+    index.loadIndices(file);
+    checkPlans(index, corpus, rng, step + " after reload");
+}
+
+} // namespace
+
+int main() {
+    fs::path directory = fs::temp_directory_path() /
+        ("supersearch-wand-test-" +
+         std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(directory);
+
+    try {
+        for (unsigned seed : {1u, 2u, 3u}) {
+            checkSeed(seed, directory);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "FAILED: " << e.what() << "\n";
+        ++IndexTestSupport::failures;
+    }
+    fs::remove_all(directory);
+
+    if (IndexTestSupport::failures == 0) {
+        std::cout << "Block-Max WAND matches exhaustive BM25 on every plan\n";
+    }
+    return IndexTestSupport::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+#include "IndexHandler.h"
+#include "IndexTestSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Deletes and updates documents, saves the index (which compacts deleted
+// documents away and renumbers the rest), loads it again and checks that
+// queries agree at every step. Also deletes documents while a background
+// merge of their segments is running, so the merge has to carry the new
+// deletion marks over to the merged segment.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using IndexTestSupport::expect;
+using IndexTestSupport::makeDocument;
+
+std::set<std::string> paths(const std::vector<std::shared_ptr<Document>>& documents) {
+    std::set<std::string> result;
+    for (const auto& doc : documents) {
+        result.insert(doc->getFilePath());
+    }
+    return result;
+}
+
+std::string describe(const std::set<std::string>& paths) {
+    std::ostringstream out;
+    out << "{";
+    for (const auto& path : paths) {
+        out << " " << path;
+    }
+    out << " }";
+    return out.str();
+}
+
+void expectPaths(const std::vector<std::shared_ptr<Document>>& documents, const std::set<std::string>& expected,
+                 const std::string& what) {
+    std::set<std::string> found = paths(documents);
+    expect(documents.size() == expected.size() && found == expected,
+           what + ": got " + describe(found) + ", expected " + describe(expected));
+}
+
+// Every document matching term, found both by search and by a ranked
+// query, with the same count and with docIds that load the same document
+void expectConsistent(const IndexHandler& index, const std::string& term, const std::set<std::string>& expected,
+                      const std::string& what) {
+    std::vector<std::shared_ptr<Document>> found = index.search(term);
+    expectPaths(found, expected, what + ", search " + term);
+
+    QueryPlan plan;
+    plan.terms.push_back(term);
+    SearchResults ranked = index.getTopDocuments(plan, 1000);
+    expect(ranked.totalMatches == expected.size() && ranked.exactTotal,
+           what + ", ranked " + term + " total " + std::to_string(ranked.totalMatches));
+    expectPaths(ranked.documents, expected, what + ", ranked " + term);
+
+    for (const auto& doc : found) {
+        std::shared_ptr<Document> loaded = index.loadDocument(doc->getDocId());
+        expect(loaded && loaded->getFilePath() == doc->getFilePath(),
+               what + ", docId " + std::to_string(doc->getDocId()) + " loads " + doc->getFilePath());
+    }
+}
+
+// After a save and load, the documents are numbered 0 .. count - 1
+void expectDenseDocIds(const IndexHandler& index, const std::string& term, size_t count, const std::string& what) {
+    std::vector<uint32_t> docIds;
+    for (const auto& doc : index.search(term)) {
+        docIds.push_back(doc->getDocId());
+    }
+    std::sort(docIds.begin(), docIds.end());
+    bool dense = docIds.size() == count;
+    for (size_t i = 0; dense && i < docIds.size(); ++i) {
+        dense = docIds[i] == i;
+    }
+    expect(dense, what + ", docIds not 0.." + std::to_string(count - 1));
+}
+
+void deleteUpdateSaveLoad(const fs::path& directory) {
+    std::string first = (directory / "first.dat").string();
+    std::string second = (directory / "second.dat").string();
+    {
+        IndexHandler index;
+        index.setSegmentSize(2);
+        for (int i = 0; i < 6; ++i) {
+            std::string n = std::to_string(i);
+            index.addDocument(makeDocument("doc" + n, "common only" + n));
+        }
+        expect(index.removeDocument("doc1"), "remove doc1");
+        expect(index.removeDocument("doc4"), "remove doc4");
+        expect(!index.removeDocument("doc1"), "doc1 removed twice");
+        expect(!index.removeDocument("missing"), "remove a path never added");
+        expect(index.updateDocument(makeDocument("doc2", "common fresh")), "update doc2");
+        expect(!index.updateDocument(makeDocument("doc6", "common added")), "update adds doc6");
+        index.finalizeIndex();
+        index.waitForMerges();
+
+        std::string step = "before save";
+        expectConsistent(index, "common", {"doc0", "doc2", "doc3", "doc5", "doc6"}, step);
+        expectConsistent(index, "only1", {}, step);
+        expectConsistent(index, "only2", {}, step);
+        expectConsistent(index, "only4", {}, step);
+        expectConsistent(index, "fresh", {"doc2"}, step);
+        expectConsistent(index, "added", {"doc6"}, step);
+        index.saveIndices(first);
+
+        // The index saved from keeps its own docIds
+        expectConsistent(index, "common", {"doc0", "doc2", "doc3", "doc5", "doc6"}, "after save");
+    }
+    {
+        IndexHandler index;
+        index.loadIndices(first);
+        std::string step = "first load";
+        expectConsistent(index, "common", {"doc0", "doc2", "doc3", "doc5", "doc6"}, step);
+        expectConsistent(index, "only1", {}, step);
+        expectConsistent(index, "only2", {}, step);
+        expectConsistent(index, "fresh", {"doc2"}, step);
+        expectDenseDocIds(index, "common", 5, step);
+        expect(index.mergeStats().deletedDocuments == 0, step + ", deletions left in the loaded index");
+
+        // Deleted documents stay gone, and the loaded ones can be deleted
+        // and updated in turn
+        expect(!index.removeDocument("doc1"), step + ", doc1 came back");
+        expect(index.removeDocument("doc3"), step + ", remove doc3");
+        expect(index.updateDocument(makeDocument("doc0", "common later")), step + ", update doc0");
+        index.finalizeIndex();
+        index.waitForMerges();
+        step = "after load";
+        expectConsistent(index, "common", {"doc0", "doc2", "doc5", "doc6"}, step);
+        expectConsistent(index, "only0", {}, step);
+        expectConsistent(index, "only3", {}, step);
+        expectConsistent(index, "later", {"doc0"}, step);
+        index.saveIndices(second);
+    }
+    {
+        IndexHandler index;
+        index.loadIndices(second);
+        std::string step = "second load";
+        expectConsistent(index, "common", {"doc0", "doc2", "doc5", "doc6"}, step);
+        expectConsistent(index, "only0", {}, step);
+        expectConsistent(index, "only1", {}, step);
+        expectConsistent(index, "only3", {}, step);
+        expectConsistent(index, "later", {"doc0"}, step);
+        expectConsistent(index, "fresh", {"doc2"}, step);
+        expectDenseDocIds(index, "common", 4, step);
+    }
+}
+
+void deleteDuringMerge(const fs::path& directory) {
+    std::string file = (directory / "merged.dat").string();
+    {
+        // Two segments of five documents, merged as soon as the second is
+        // published. Large titles and a tight budget keep the merge going
+        // for about a second, long enough to delete from its inputs.
+        IndexHandler index;
+        index.setSegmentSize(5);
+        index.setMergePolicy(TieredMergePolicy(2, 5));
+        index.setMergeBudget(128.0 * 1024, 1.0);
+        std::string title(16 * 1024, 't');
+        for (int i = 0; i < 10; ++i) {
+            std::string n = std::to_string(i);
+            index.addDocument(makeDocument("merge" + n, "shared own" + n, title));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        expect(index.removeDocument("merge1"), "remove merge1");
+        expect(index.updateDocument(makeDocument("merge7", "shared replaced")), "update merge7");
+        index.finalizeIndex();
+        index.waitForMerges();
+
+        std::string step = "merge";
+        MergeStats stats = index.mergeStats();
+        expect(stats.merges >= 1, step + ", no merge ran");
+        expect(stats.deletedDocuments + stats.documentsRemoved == 2,
+               step + ", deletions lost: " + std::to_string(stats.deletedDocuments) + " carried, " +
+               std::to_string(stats.documentsRemoved) + " removed");
+        expect(stats.deletedDocuments == 2, step + ", deletions did not arrive during the merge");
+        std::set<std::string> live{"merge0", "merge2", "merge3", "merge4", "merge5",
+                                   "merge6", "merge7", "merge8", "merge9"};
+        expectConsistent(index, "shared", live, step);
+        expectConsistent(index, "own1", {}, step);
+        expectConsistent(index, "own7", {}, step);
+        expectConsistent(index, "replaced", {"merge7"}, step);
+        index.saveIndices(file);
+    }
+    {
+        IndexHandler index;
+        index.loadIndices(file);
+        std::string step = "merge load";
+        expectConsistent(index, "shared", {"merge0", "merge2", "merge3", "merge4", "merge5",
+                                           "merge6", "merge7", "merge8", "merge9"}, step);
+        expectConsistent(index, "own1", {}, step);
+        expectConsistent(index, "own7", {}, step);
+        expectConsistent(index, "replaced", {"merge7"}, step);
+        expectDenseDocIds(index, "shared", 9, step);
+    }
+}
+
+} // namespace
+
+int main() {
+    fs::path directory = fs::temp_directory_path() /
+        ("supersearch-deletion-test-" +
+         std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(directory);
+
+    try {
+        deleteUpdateSaveLoad(directory);
+        deleteDuringMerge(directory);
+    } catch (const std::exception& e) {
+        std::cerr << "FAILED: " << e.what() << "\n";
+        ++IndexTestSupport::failures;
+    }
+    fs::remove_all(directory);
+
+    if (IndexTestSupport::failures == 0) {
+        std::cout << "Deletion, update, save and load: all checks passed\n";
+    }
+    return IndexTestSupport::failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+#ifndef INDEXTESTSUPPORT_H
+#define INDEXTESTSUPPORT_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Document.h"
+
+// Helpers shared by the tests that build indexes from hand-made documents
+namespace IndexTestSupport {
+
+inline int failures = 0;
+
+inline void expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+// A document whose terms are the space-separated words of text
+inline std::unique_ptr<Document> makeDocument(const std::string& path, const std::string& text,
+                                              const std::string& title = "") {
+    auto doc = std::make_unique<Document>(path);
+    doc->setTitle(title.empty() ? path : title);
+    std::vector<char> buffer(text.begin(), text.end());
+    std::vector<std::string_view> terms;
+    size_t start = 0;
+    while (start < buffer.size()) {
+        size_t end = text.find(' ', start);
+        if (end == std::string::npos) {
+            end = buffer.size();
+        }
+        if (end > start) {
+            terms.emplace_back(buffer.data() + start, end - start);
+        }
+        start = end + 1;
+    }
+    doc->setTerms(std::move(buffer), std::move(terms));
+    return doc;
+}
+
+} // namespace IndexTestSupport
+
+#endif
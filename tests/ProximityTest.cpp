@@ -0,0 +1,190 @@
+#include "IndexHandler.h"
+#include "IndexTestSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Checks phrase and NEAR/n queries against a scan of every document's
+// terms. The index goes through background merges, deletions, a merge
+// that drops deleted documents and a compacting save and load; the last
+// two rewrite positions through PostingList::appendList's slow path.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using IndexTestSupport::expect;
+using IndexTestSupport::makeDocument;
+
+constexpr size_t DOCUMENTS = 600;
+constexpr size_t SEGMENT_SIZE = 23;
+constexpr size_t VOCABULARY = 12;
+constexpr size_t CLAUSES = 300;
+
+// The terms of the documents the index should hold, by path
+using Corpus = std::map<std::string, std::vector<std::string>>;
+
+std::string word(size_t index) {
+    return "p" + std::to_string(index);
+}
+
+bool containsPhrase(const std::vector<std::string>& terms, const std::vector<std::string>& phrase) {
+    for (size_t start = 0; start + phrase.size() <= terms.size(); ++start) {
+        if (std::equal(phrase.begin(), phrase.end(), terms.begin() + start)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool containsNear(const std::vector<std::string>& terms, const std::string& a, const std::string& b,
+                  uint32_t distance) {
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (terms[i] != a) continue;
+        for (size_t j = 0; j < terms.size(); ++j) {
+            if (terms[j] == b && static_cast<size_t>(std::abs(static_cast<long>(i) - static_cast<long>(j))) <= distance) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// A random clause; phrases are half the time copied out of a document so
+// that long ones match something
+ProximityClause randomClause(const Corpus& corpus, std::mt19937& rng) {
+    ProximityClause clause;
+    if (rng() % 3 == 0) {
+        clause.kind = ProximityClause::Kind::NEAR;
+        clause.terms = {word(rng() % VOCABULARY), word(rng() % VOCABULARY)};
+        clause.distance = rng() % 6;
+        return clause;
+    }
+    size_t length = 2 + rng() % 3;
+    auto doc = std::next(corpus.begin(), rng() % corpus.size());
+    if (rng() % 2 == 0 && doc->second.size() >= length) {
+        size_t start = rng() % (doc->second.size() - length + 1);
+        clause.terms.assign(doc->second.begin() + start, doc->second.begin() + start + length);
+    } else {
+        for (size_t i = 0; i < length; ++i) {
+            clause.terms.push_back(word(rng() % VOCABULARY));
+        }
+    }
+    return clause;
+}
+
+void checkClauses(const IndexHandler& index, const Corpus& corpus, std::mt19937& rng, const std::string& step) {
+    size_t matched = 0;
+    for (size_t c = 0; c < CLAUSES; ++c) {
+        ProximityClause clause = randomClause(corpus, rng);
+        bool near = clause.kind == ProximityClause::Kind::NEAR;
+
+        std::set<std::string> expected;
+        for (const auto& entry : corpus) {
+            if (near ? containsNear(entry.second, clause.terms[0], clause.terms[1], clause.distance)
+                     : containsPhrase(entry.second, clause.terms)) {
+                expected.insert(entry.first);
+            }
+        }
+
+        // As QueryProcessor builds them: every clause term is also required
+        QueryPlan plan;
+        plan.terms = clause.terms;
+        plan.proximities.push_back(clause);
+        SearchResults results = index.getTopDocuments(plan, DOCUMENTS);
+        std::set<std::string> found;
+        for (const auto& doc : results.documents) {
+            found.insert(doc->getFilePath());
+        }
+
+        std::string what = step + (near ? ", NEAR/" + std::to_string(clause.distance) : ", phrase");
+        for (const auto& term : clause.terms) {
+            what += " " + term;
+        }
+        expect(found == expected && results.documents.size() == expected.size(),
+               what + ": " + std::to_string(found.size()) + " documents, expected " +
+               std::to_string(expected.size()));
+        expect(results.totalMatches == expected.size(),
+               what + ": total " + std::to_string(results.totalMatches));
+        matched += !expected.empty();
+    }
+    expect(matched > CLAUSES / 4, step + ", too few clauses match anything to be a test");
+}
+
+void deleteRandom(IndexHandler& index, Corpus& corpus, std::mt19937& rng, size_t count, const std::string& step) {
+    for (size_t i = 0; i < count; ++i) {
+        auto doc = std::next(corpus.begin(), rng() % corpus.size());
+        expect(index.removeDocument(doc->first), step + ", remove " + doc->first);
+        corpus.erase(doc);
+    }
+    index.finalizeIndex();
+    index.waitForMerges();
+}
+
+} // namespace
+
+int main() {
+    fs::path directory = fs::temp_directory_path() /
+        ("supersearch-proximity-test-" +
+         std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(directory);
+    std::string file = (directory / "proximity.dat").string();
+
+    try {
+        std::mt19937 rng(7);
+        Corpus corpus;
+        {
+            // Merges stop at a few hundred documents, so several segments
+            // remain, and rewrite one once a fifth of it is deleted
+            IndexHandler index;
+            index.setStorePositions(true);
+            index.setSegmentSize(SEGMENT_SIZE);
+            index.setMergePolicy(TieredMergePolicy(4, SEGMENT_SIZE, 300, 0.2));
+            for (size_t i = 0; i < DOCUMENTS; ++i) {
+                std::string path = "doc" + std::to_string(i);
+                std::vector<std::string>& terms = corpus[path];
+                std::string text;
+                for (size_t length = 1 + rng() % 40; length > 0; --length) {
+                    terms.push_back(word(rng() % VOCABULARY));
+                    text += terms.back() + " ";
+                }
+                index.addDocument(makeDocument(path, text));
+            }
+            index.finalizeIndex();
+            index.waitForMerges();
+            expect(index.mergeStats().merges > 0, "no merge ran");
+            checkClauses(index, corpus, rng, "merged");
+
+            // A few deletions stay marked in their segments
+            deleteRandom(index, corpus, rng, 20, "marked");
+            checkClauses(index, corpus, rng, "marked");
+
+            // Enough that merges rewrite segments without them
+            size_t removedBefore = index.mergeStats().documentsRemoved;
+            deleteRandom(index, corpus, rng, DOCUMENTS / 4, "dropped");
+            expect(index.mergeStats().documentsRemoved > removedBefore, "no merge dropped deleted documents");
+            checkClauses(index, corpus, rng, "dropped");
+            index.saveIndices(file);
+        }
+        IndexHandler index;
+        index.loadIndices(file);
+        expect(index.hasPositions(), "positions lost on reload");
+        checkClauses(index, corpus, rng, "reloaded");
+    } catch (const std::exception& e) {
+        std::cerr << "FAILED: " << e.what() << "\n";
+        ++IndexTestSupport::failures;
+    }
+    fs::remove_all(directory);
+
+    if (IndexTestSupport::failures == 0) {
+        std::cout << "Phrase and NEAR queries match a full scan\n";
+    }
+    return IndexTestSupport::failures == 0 ? 0 : 1;
+}
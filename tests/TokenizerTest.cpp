@@ -0,0 +1,181 @@
+#include "Tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Checks every kernel the CPU supports against the original
+// cleanText + istringstream + tolower pipeline, byte for byte.
+
+namespace {
+
+std::vector<std::string> referenceTokens(const std::string& text) {
+    std::string cleaned;
+    cleaned.reserve(text.length());
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (std::ispunct(byte)) {
+            cleaned += ' ';
+        } else if (std::isalnum(byte) || std::isspace(byte)) {
+            cleaned += c;
+        }
+    }
+
+    std::vector<std::string> tokens;
+    std::istringstream iss(cleaned);
+    std::string word;
+    while (iss >> word) {
+        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+        tokens.push_back(word);
+    }
+    return tokens;
+}
+
+std::vector<Tokenizer::Kernel> availableKernels() {
+    std::vector<Tokenizer::Kernel> kernels{Tokenizer::Kernel::SCALAR};
+    Tokenizer::Kernel best = Tokenizer::selectKernel();
+    if (best == Tokenizer::Kernel::SSE2 || best == Tokenizer::Kernel::AVX2) {
+        kernels.push_back(Tokenizer::Kernel::SSE2);
+    }
+    if (best == Tokenizer::Kernel::AVX2) {
+        kernels.push_back(Tokenizer::Kernel::AVX2);
+    }
+    return kernels;
+}
+
+const char* kernelName(Tokenizer::Kernel kernel) {
+    switch (kernel) {
+        case Tokenizer::Kernel::SSE2: return "SSE2";
+        case Tokenizer::Kernel::AVX2: return "AVX2";
+        default: return "SCALAR";
+    }
+}
+
+std::string escape(const std::string& text) {
+    static const char hex[] = "0123456789abcdef";
+    std::string out;
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte >= 0x20 && byte < 0x7F && byte != '\\') {
+            out += c;
+        } else {
+            out += "\\x";
+            out += hex[byte >> 4];
+            out += hex[byte & 0xF];
+        }
+    }
+    return out;
+}
+
+// Run one input through a kernel, trying a few offsets so chunk loads start
+// on and off alignment
+bool check(const std::string& text, Tokenizer::Kernel kernel) {
+    std::vector<std::string> expected = referenceTokens(text);
+    std::vector<std::string_view> tokens;
+    for (size_t offset = 0; offset < 4; ++offset) {
+        std::string buffer(offset, 'x');
+        buffer += text;
+        Tokenizer::tokenize(buffer.data() + offset, text.length(), tokens, kernel);
+
+        bool same = tokens.size() == expected.size();
+        for (size_t i = 0; same && i < tokens.size(); ++i) {
+            same = tokens[i] == expected[i];
+        }
+        if (!same) {
+            std::cerr << kernelName(kernel) << " mismatch at offset " << offset
+                      << " on \"" << escape(text) << "\"\n  expected:";
+            for (const auto& token : expected) std::cerr << " [" << escape(token) << "]";
+            std::cerr << "\n  got:     ";
+            for (const auto& token : tokens) std::cerr << " [" << escape(std::string(token)) << "]";
+            std::cerr << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> fixedCorpus() {
+    return {
+        "",
+        "Hello, World!",
+        "The Federal Reserve raised rates by 0.25% on Wednesday -- its 10th hike since March 2022.",
+        "U.S. stocks fell; the S&P 500 dropped 1.2% and the Nasdaq-100 lost 2.1% (its worst day in weeks).",
+        "\"Quoted\" text, 'single quotes', [brackets], {braces} and <angle> brackets.",
+        "Tabs\tnewlines\nCR\rvertical\vfeed\fmixed   spaces",
+        "caf\xc3\xa9 na\xc3\xafve r\xc3\xa9sum\xc3\xa9 \xe2\x80\x9csmart quotes\xe2\x80\x9d \xe2\x80\x94 em dash",
+        "Stra\xc3\x9f" "e M\xc3\xbcnchen \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e \xf0\x9f\x98\x80 emoji",
+        "ctrl\x01" "chars\x02in\x1fthe\x7fmiddle",
+        "ALLCAPS MiXeD cAsE lowercase 1234567890 abc123def",
+        "email@example.com http://example.com/path?query=1&x=2#frag",
+        "a b c d e f g h i j k l m n o p q r s t u v w x y z A B C D E F G H I J K L M N O P",
+        "word-word_word.word,word;word:word!word?word/word\\word|word~word`word^word",
+    };
+}
+
+// Edge cases built around the 16 and 32 byte chunk widths
+std::vector<std::string> generatedCases() {
+    std::vector<std::string> cases;
+    const std::string delimiters = " \t\n\v\f\r!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+    for (size_t length = 0; length <= 100; ++length) {
+        // One long token ending on either side of a chunk boundary
+        cases.push_back(std::string(length, 'A'));
+        // Tail after a full chunk
+        cases.push_back(std::string(length, 'a') + " tail");
+        // Nothing but delimiters
+        std::string delimiterRun;
+        for (size_t i = 0; i < length; ++i) delimiterRun += delimiters[i % delimiters.length()];
+        cases.push_back(delimiterRun);
+        cases.push_back(std::string(length, ' '));
+        // A non-ASCII byte at every position
+        std::string word(length + 1, 'w');
+        word[length] = '\xc3';
+        cases.push_back(word + "\xa9x");
+        // A single delimiter at every position
+        std::string split(65, 'Q');
+        if (length < split.length()) split[length] = '.';
+        cases.push_back(split);
+    }
+
+    std::mt19937 rng(20240617);
+    const std::string alphabet = "aZ9 .,\t-";
+    for (int i = 0; i < 2000; ++i) {
+        size_t length = rng() % 200;
+        std::string text(length, ' ');
+        for (auto& c : text) {
+            switch (rng() % 4) {
+                case 0: c = static_cast<char>(rng() % 256); break;
+                case 1: c = alphabet[rng() % alphabet.length()]; break;
+                default: c = static_cast<char>('a' + rng() % 26); break;
+            }
+        }
+        cases.push_back(text);
+    }
+    return cases;
+}
+
+} // namespace
+
+int main() {
+    std::vector<std::string> inputs = fixedCorpus();
+    std::vector<std::string> generated = generatedCases();
+    inputs.insert(inputs.end(), generated.begin(), generated.end());
+
+    int failures = 0;
+    for (Tokenizer::Kernel kernel : availableKernels()) {
+        size_t passed = 0;
+        for (const auto& text : inputs) {
+            if (check(text, kernel)) {
+                ++passed;
+            } else if (++failures >= 20) {
+                std::cerr << "Too many failures, stopping\n";
+                return 1;
+            }
+        }
+        std::cout << kernelName(kernel) << ": " << passed << "/" << inputs.size() << " inputs match\n";
+    }
+    return failures == 0 ? 0 : 1;
+}